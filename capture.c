@@ -0,0 +1,86 @@
+#include <xc.h>
+#include "pwm.h"
+#include "capture.h"
+#include "horloge.h"
+
+/*
+ * Mesure des impulsions de radio-contrôle d'un récepteur RC standard,
+ * avec les modules CCP2 (RC1, canal 0) et CCP5 (RA4, canal 1) en mode
+ * capture sur le temporisateur 3 (HORLOGE_PAS_PAR_4US pas pour 4us).
+ * Chaque module capture le flanc montant, puis le flanc descendant,
+ * et la durée mesurée passe par le filtre médian de pwm.c.
+ */
+
+/** Capture sur chaque flanc montant. */
+#define CAPTURE_FLANC_MONTANT 0b0101
+
+/** Capture sur chaque flanc descendant. */
+#define CAPTURE_FLANC_DESCENDANT 0b0100
+
+/**
+ * Traite les captures des deux canaux.
+ * @return Un bit par canal dont la valeur vient d'être mise à jour.
+ */
+unsigned char captureInterruptions() {
+    unsigned char nouveaux = 0;
+    unsigned int instant;
+
+    if (PIR2bits.CCP2IF) {
+        instant = ((unsigned int) CCPR2H << 8) | CCPR2L;
+        if (CCP2CONbits.CCP2M == CAPTURE_FLANC_MONTANT) {
+            pwmDemarreCapture(0, instant);
+            CCP2CONbits.CCP2M = CAPTURE_FLANC_DESCENDANT;
+        } else {
+            if (pwmCompleteCaptureFiltree(0, instant)) {
+                nouveaux |= 1;
+            }
+            CCP2CONbits.CCP2M = CAPTURE_FLANC_MONTANT;
+        }
+        // Le changement de mode peut produire une fausse capture:
+        PIR2bits.CCP2IF = 0;
+    }
+
+    if (PIR4bits.CCP5IF) {
+        instant = ((unsigned int) CCPR5H << 8) | CCPR5L;
+        if (CCP5CONbits.CCP5M == CAPTURE_FLANC_MONTANT) {
+            pwmDemarreCapture(1, instant);
+            CCP5CONbits.CCP5M = CAPTURE_FLANC_DESCENDANT;
+        } else {
+            if (pwmCompleteCaptureFiltree(1, instant)) {
+                nouveaux |= 2;
+            }
+            CCP5CONbits.CCP5M = CAPTURE_FLANC_MONTANT;
+        }
+        PIR4bits.CCP5IF = 0;
+    }
+
+    return nouveaux;
+}
+
+/**
+ * Initialise le temporisateur 3 et les modules CCP2 et CCP5.
+ */
+void captureInitialiseHardware() {
+    // Entrées des impulsions:
+    TRISCbits.RC1 = 1;          // RC1 (CCP2, selon CCP2MX) comme entrée.
+    TRISAbits.RA4 = 1;          // RA4 (CCP5) comme entrée...
+    ANSELAbits.ANSA4 = 0;       // ... digitale.
+
+    // Temporisateur 3 en libre cours, HORLOGE_PAS_PAR_4US pas pour 4us:
+    T3CONbits.TMR3CS = 0;       // Source: FOSC / 4.
+    T3CONbits.T3CKPS = HORLOGE_T13CKPS;
+    T3CONbits.T3RD16 = 1;       // Lecture 16 bits.
+    T3CONbits.TMR3ON = 1;       // Active le temporisateur.
+
+    CCPTMRS0bits.C2TSEL = 1;    // Branche le CCP2 sur le temporisateur 3.
+    CCPTMRS1bits.C5TSEL = 1;    // Branche le CCP5 sur le temporisateur 3.
+    CCP2CONbits.CCP2M = CAPTURE_FLANC_MONTANT;
+    CCP5CONbits.CCP5M = CAPTURE_FLANC_MONTANT;
+
+    PIR2bits.CCP2IF = 0;        // Active les interruptions ...
+    PIE2bits.CCP2IE = 1;        // ... de basse priorité ...
+    IPR2bits.CCP2IP = 0;        // ... pour le CCP2 ...
+    PIR4bits.CCP5IF = 0;
+    PIE4bits.CCP5IE = 1;        // ... et le CCP5.
+    IPR4bits.CCP5IP = 0;
+}
@@ -0,0 +1,10 @@
+#ifndef CAPTURE__H
+#define CAPTURE__H
+
+/** Nombre de canaux mesurés: CCP2 et CCP5. */
+#define CAPTURE_NOMBRE_DE_CANAUX 2
+
+void captureInitialiseHardware();
+unsigned char captureInterruptions();
+
+#endif
@@ -0,0 +1,314 @@
+#include <xc.h>
+#include <stdio.h>
+#include "cycles.h"
+#include "file.h"
+#include "i2c.h"
+#include "pwm.h"
+#include "sequenceur.h"
+#include "test.h"
+
+#ifdef BANC_CYCLES
+
+/**
+ * Coût de la mesure elle-même: mise à zéro et lecture du temporisateur.
+ * Il est soustrait de toutes les mesures.
+ */
+static unsigned int cyclesReference;
+
+/** Empêche le compilateur d'éliminer les appels mesurés. */
+static volatile unsigned char puits;
+
+static File file;
+
+/** Une calibration qui passe par tous les chemins de pwmCalibre. */
+static const Calibration calibration = {20, 230, 5, 255};
+
+/** Noms des drapeaux, dans l'ordre des bits CYCLES_INT1F... */
+static const char *nomsDrapeaux[] = {
+    "INT1F", "INT2F", "TMR0IF", "ADIF", "SSP1IF", "TMR2IF", "CCP4IF"
+};
+#define NOMBRE_DRAPEAUX (sizeof(nomsDrapeaux) / sizeof(nomsDrapeaux[0]))
+
+/**
+ * Démarre la mesure. Avec T1RD16, l'écriture de TMR1L
+ * transfère aussi TMR1H.
+ */
+#define CYCLES_DEMARRE() TMR1H = 0; TMR1L = 0
+
+/**
+ * Lit le temporisateur 1.
+ * Avec T1RD16, la lecture de TMR1L fige TMR1H.
+ * @return Le nombre de cycles depuis CYCLES_DEMARRE.
+ */
+static unsigned int cyclesLit() {
+    unsigned int t = TMR1L;
+    t |= ((unsigned int) TMR1H) << 8;
+    return t;
+}
+
+/**
+ * Envoie une mesure à la console.
+ * @param nom Nom de la mesure.
+ * @param cycles Nombre de cycles lu, avant soustraction de la référence.
+ */
+static void cyclesAffiche(const char *nom, unsigned int cycles) {
+    printf("CYCLES %s %u\r\n", nom, cycles - cyclesReference);
+}
+
+/**
+ * Active le temporisateur 1, la console, et mesure la référence.
+ */
+void cyclesInitialise() {
+    T1CONbits.TMR1CS = 0;       // Source: FOSC / 4.
+    T1CONbits.T1CKPS = 0;       // Pas de diviseur de fréquence.
+    T1CONbits.T1RD16 = 1;       // Lecture / écriture 16 bits.
+    T1CONbits.TMR1ON = 1;       // Active le temporisateur.
+
+    initialiseUART1();
+
+    RCONbits.IPEN = 1;          // Active les niveaux de priorité.
+
+    CYCLES_DEMARRE();
+    cyclesReference = cyclesLit();
+}
+
+/**
+ * Mesure les fonctions de la file, de la machine d'états i2c, de la
+ * calibration, de la publication et de l'espacement PWM, dans chacun 
+ * de leurs chemins, interpolation comprise.
+ */
+void cyclesMesureFonctions() {
+    unsigned int t;
+    unsigned char n, trame, canal;
+
+    // File vide, puis pleine:
+    fileReinitialise(&file);
+    CYCLES_DEMARRE();
+    fileDefile(&file);
+    t = cyclesLit();
+    cyclesAffiche("fileDefileVide", t);
+
+    CYCLES_DEMARRE();
+    fileEnfile(&file, 1);
+    t = cyclesLit();
+    cyclesAffiche("fileEnfile", t);
+
+    CYCLES_DEMARRE();
+    puits = fileDefile(&file);
+    t = cyclesLit();
+    cyclesAffiche("fileDefile", t);
+
+    for (n = 0; n < FILE_TAILLE; n++) {
+        fileEnfile(&file, n);
+    }
+    CYCLES_DEMARRE();
+    fileEnfile(&file, 1);
+    t = cyclesLit();
+    cyclesAffiche("fileEnfilePleine", t);
+
+    // Un appel par octet d'une commande, comme le fait l'émetteur:
+    i2cReinitialise();
+    i2cPrepareCommandePourEmission(MODULE_SERVO, SERVO1, 100);
+    i2cDonneesDisponiblesPourEmission();
+    n = 0;
+    while (!i2cCommandeCompletementEmise()) {
+        CYCLES_DEMARRE();
+        puits = i2cRecupereCaracterePourEmission();
+        t = cyclesLit();
+        printf("CYCLES i2cRecupereCaracterePourEmission%u %u\r\n",
+                n++, t - cyclesReference);
+    }
+
+    // Reconstruction d'une table de calibration, puis une valeur calibrée:
+    pwmReinitialise();
+    CYCLES_DEMARRE();
+    pwmCalibre(0, &calibration);
+    t = cyclesLit();
+    cyclesAffiche("pwmCalibre", t);
+
+    pwmPrepareValeur(0);
+    CYCLES_DEMARRE();
+    pwmEtablitValeur(100);
+    t = cyclesLit();
+    cyclesAffiche("pwmEtablitValeur", t);
+
+    // Publication de tous les canaux:
+    pwmReinitialise();
+    CYCLES_DEMARRE();
+    pwmPublie();
+    t = cyclesLit();
+    cyclesAffiche("pwmPublie", t);
+
+    // Les deux chemins de l'espacement:
+    pwmReinitialise();
+    CYCLES_DEMARRE();
+    puits = pwmEspacement();
+    t = cyclesLit();
+    cyclesAffiche("pwmEspacement", t);
+
+    // Avance jusqu'à la veille de la trame suivante:
+    while (!pwmEspacement());
+    for (n = 1; n < 255 && !pwmEspacement(); n++);
+    trame = n;
+    pwmReinitialise();
+    while (--n) {
+        pwmEspacement();
+    }
+    pwmPublie();                // Le pire cas bascule de table.
+    CYCLES_DEMARRE();
+    puits = pwmEspacement();
+    t = cyclesLit();
+    cyclesAffiche("pwmEspacementTrame", t);
+
+    // Le pire cas de l'interpolation: tous les canaux se déplacent.
+    for (canal = 0; canal < PWM_NOMBRE_DE_CANAUX; canal++) {
+        pwmPrepareValeur(canal);
+        pwmEtablitValeur(0);
+    }
+    pwmPublie();
+    while (!pwmEspacement());
+    for (canal = 0; canal < PWM_NOMBRE_DE_CANAUX; canal++) {
+        pwmPrepareValeur(canal);
+        pwmEtablitVitesse(1);
+        pwmEtablitValeur(255);
+    }
+    pwmPublie();
+    for (n = 1; n < trame; n++) {
+        pwmEspacement();
+    }
+    CYCLES_DEMARRE();
+    puits = pwmEspacement();
+    t = cyclesLit();
+    cyclesAffiche("pwmEspacementInterpolation", t);
+}
+
+/**
+ * Active les sources d'interruption indiquées, avec leur priorité.
+ * @param drapeaux Combinaison de CYCLES_INT1F, CYCLES_INT2F...
+ */
+static void cyclesActiveSources(unsigned char drapeaux) {
+    unsigned char haute = (drapeaux & CYCLES_HAUTE) ? 1 : 0;
+
+    if (drapeaux & CYCLES_INT1F) {
+        INTCON3bits.INT1E = 1;
+        INTCON3bits.INT1IP = haute;
+    }
+    if (drapeaux & CYCLES_INT2F) {
+        INTCON3bits.INT2E = 1;
+        INTCON3bits.INT2IP = haute;
+    }
+    if (drapeaux & CYCLES_TMR0IF) {
+        INTCONbits.TMR0IE = 1;
+        INTCON2bits.TMR0IP = haute;
+    }
+    if (drapeaux & CYCLES_ADIF) {
+        PIE1bits.ADIE = 1;
+        IPR1bits.ADIP = haute;
+    }
+    if (drapeaux & CYCLES_SSP1IF) {
+        PIE1bits.SSP1IE = 1;
+        IPR1bits.SSP1IP = haute;
+    }
+    if (drapeaux & CYCLES_TMR2IF) {
+        PIE1bits.TMR2IE = 1;
+        IPR1bits.TMR2IP = haute;
+    }
+    if (drapeaux & CYCLES_CCP4IF) {
+        PIE4bits.CCP4IE = 1;
+        IPR4bits.CCP4IP = haute;
+    }
+}
+
+/**
+ * Lève les drapeaux d'interruption indiqués.
+ * @param drapeaux Combinaison de CYCLES_INT1F, CYCLES_INT2F...
+ */
+static void cyclesLeveDrapeaux(unsigned char drapeaux) {
+    INTCON3bits.INT1F = (drapeaux & CYCLES_INT1F) ? 1 : 0;
+    INTCON3bits.INT2F = (drapeaux & CYCLES_INT2F) ? 1 : 0;
+    INTCONbits.TMR0IF = (drapeaux & CYCLES_TMR0IF) ? 1 : 0;
+    PIR1bits.ADIF = (drapeaux & CYCLES_ADIF) ? 1 : 0;
+    PIR1bits.SSP1IF = (drapeaux & CYCLES_SSP1IF) ? 1 : 0;
+    PIR1bits.TMR2IF = (drapeaux & CYCLES_TMR2IF) ? 1 : 0;
+    PIR4bits.CCP4IF = (drapeaux & CYCLES_CCP4IF) ? 1 : 0;
+}
+
+#ifdef PWM_SEQUENCEUR
+/**
+ * Prépare le pire cas de l'interruption du séquenceur: tous les canaux
+ * sont actifs, et la prochaine interruption est la fin de la trame,
+ * qui bascule sur la table préparée et active toutes les sorties.
+ * Le coût de l'interruption ne dépend pas du nombre de canaux; les
+ * mesures avec 2, 8 et 16 canaux (PWM_NOMBRE_DE_CANAUX) le vérifient.
+ */
+void cyclesPrepareSequenceur() {
+    unsigned char canal;
+
+    pwmReinitialise();
+    sequenceurReinitialise();
+    for (canal = 0; canal < PWM_NOMBRE_DE_CANAUX; canal++) {
+        pwmPrepareValeur(canal);
+        pwmEtablitValeur((canal + 1) << 3);
+    }
+    sequenceurPrepare();
+}
+#endif
+
+/**
+ * Mesure la routine d'interruption complète, depuis la levée des
+ * drapeaux jusqu'au retour, pour chaque combinaison non vide des
+ * drapeaux indiqués. Le mode (émetteur ou récepteur) doit avoir été
+ * choisi par l'appelant.
+ * Chaque mesure s'appelle <nom>+<drapeau>+<drapeau>...
+ * @param nom Préfixe du nom des mesures.
+ * @param drapeaux Combinaison de CYCLES_INT1F, CYCLES_INT2F...
+ * et éventuellement CYCLES_HAUTE.
+ */
+void cyclesMesureInterruptions(const char *nom, unsigned char drapeaux) {
+    unsigned char masque = drapeaux & ~CYCLES_HAUTE;
+    unsigned char combinaison, n;
+    unsigned int t;
+
+    INTCONbits.GIEH = 0;
+    INTCONbits.GIEL = 0;
+    cyclesActiveSources(drapeaux);
+
+    combinaison = masque;
+    while (combinaison) {
+        cyclesLeveDrapeaux(combinaison);
+        if (drapeaux & CYCLES_HAUTE) {
+            CYCLES_DEMARRE();
+            INTCONbits.GIEH = 1;
+        } else {
+            INTCONbits.GIEH = 1;
+            CYCLES_DEMARRE();
+            INTCONbits.GIEL = 1;
+        }
+        t = cyclesLit();
+        INTCONbits.GIEH = 0;
+        INTCONbits.GIEL = 0;
+        // Une routine qui n'efface pas ses drapeaux est mesurée une fois:
+        cyclesLeveDrapeaux(0);
+
+        printf("CYCLES %s", nom);
+        for (n = 0; n < NOMBRE_DRAPEAUX; n++) {
+            if (combinaison & (1 << n)) {
+                printf("+%s", nomsDrapeaux[n]);
+            }
+        }
+        printf(" %u\r\n", t - cyclesReference);
+
+        combinaison = (combinaison - 1) & masque;
+    }
+}
+
+/**
+ * Appelée quand toutes les mesures ont été envoyées.
+ * outils/cycles.sh place un point d'arrêt sur cette fonction.
+ */
+void cyclesFin() {
+    printf("FIN\r\n");
+    while (!TXSTAbits.TRMT);
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef CYCLES__H
+#define CYCLES__H
+
+/**
+ * Banc d'essai en cycles d'instruction, compilé avec l'option
+ * BANC_CYCLES (configuration MPLAB "cycles").
+ * Le programme mesure les fonctions du chemin des interruptions avec
+ * le temporisateur 1, puis envoie le résultat à la EUSART, une ligne
+ * par mesure:
+ *     CYCLES <nom> <cycles>
+ * Il s'exécute sous gpsim (voir outils/cycles.sh) ou sur le matériel.
+ */
+
+#ifdef BANC_CYCLES
+
+/**
+ * Drapeaux d'interruption, pour cyclesMesureInterruptions.
+ */
+#define CYCLES_INT1F    0x01
+#define CYCLES_INT2F    0x02
+#define CYCLES_TMR0IF   0x04
+#define CYCLES_ADIF     0x08
+#define CYCLES_SSP1IF   0x10
+#define CYCLES_TMR2IF   0x20
+#define CYCLES_CCP4IF   0x40
+/** Les drapeaux sont de haute priorité au lieu de basse. */
+#define CYCLES_HAUTE    0x80
+
+void cyclesInitialise();
+void cyclesMesureFonctions();
+void cyclesMesureInterruptions(const char *nom, unsigned char drapeaux);
+#ifdef PWM_SEQUENCEUR
+void cyclesPrepareSequenceur();
+#endif
+void cyclesFin();
+
+#endif
+
+#endif
@@ -1,44 +1,287 @@
 #include <xc.h>
 #include "pwm.h"
 #include "i2c.h"
+#include "filtre.h"
+#include "capture.h"
+#include "trace.h"
+#include "veille.h"
+#include "horloge.h"
+#include "test.h"
+
+/*
+ * Options de compilation (à définir dans les options du projet):
+ *
+ * EMETTEUR_BALAYAGE: Au lieu d'attendre un flanc sur INT1 ou INT2, 
+ * l'émetteur mesure en continu toutes les entrées analogiques, à tour de
+ * rôle, et n'émet la valeur d'un canal que si elle s'est éloignée de plus
+ * de EMETTEUR_ZONE_MORTE de la dernière valeur émise.
+ *
+ * EMETTEUR_FILTRE: Chaque valeur émise est la moyenne de 
+ * 2^FILTRE_LOG2_ECHANTILLONS conversions de 10 bits (voir filtre.c),
+ * ce qui élimine le bruit de la conversion. Elle est émise sur 10 bits
+ * (registres PRECIS1, voir i2c.h).
+ *
+ * EMETTEUR_CAPTURE: L'émetteur sert de pont: il mesure les impulsions
+ * d'un récepteur de radio-contrôle (voir capture.c) et transmet leur 
+ * valeur par I2C, au lieu de mesurer des entrées analogiques.
+ *
+ * EMETTEUR_APPEL_GENERAL: Les valeurs sont émises à l'adresse d'appel
+ * général, et tous les récepteurs du bus les appliquent en même temps,
+ * quel que soit leur numéro. Sans cette option, elles ne vont qu'au
+ * récepteur sans cavalier (MODULE_SERVO). La lecture de l'état vise 
+ * toujours MODULE_SERVO, car l'appel général ne permet pas de lecture.
+ */
+
+/**
+ * Diviseur du temporisateur 0, en puissance de 2, pour qu'il déborde
+ * toutes les 1ms (EMETTEUR_FILTRE, qui fait plusieurs conversions par
+ * valeur) ou toutes les 4ms, quel que soit le profil d'horloge.
+ */
+#ifdef EMETTEUR_FILTRE
+#define EMETTEUR_LOG2_DIVISEUR_TMR0 HORLOGE_LOG2_MHZ
+#else
+#define EMETTEUR_LOG2_DIVISEUR_TMR0 (HORLOGE_LOG2_MHZ + 2)
+#endif
+
+#ifdef EMETTEUR_APPEL_GENERAL
+#define EMETTEUR_ADRESSE APPEL_GENERAL
+#else
+#define EMETTEUR_ADRESSE MODULE_SERVO
+#endif
+
+/** Indique qu'une transaction I2C est en cours, entre START et STOP. */
+static unsigned char emissionEnCours = 0;
+
+/**
+ * Démarre la transmission si le bus est libre et qu'il y a des données
+ * à émettre. Si le bus est occupé, elles partiront dans la même 
+ * transaction, après un START répété.
+ */
+static void emetteurDemarre() {
+    if (!emissionEnCours) {
+        if (i2cDonneesDisponiblesPourEmission()) {
+            emissionEnCours = 255;
+            SSP1CON2bits.SEN = 1;
+        }
+    }
+}
+
+/**
+ * Dépose la valeur d'un servo dans la boîte aux lettres, et démarre
+ * la transmission si le bus est libre. Si le bus est occupé, la valeur
+ * attend dans la boîte aux lettres, et remplace celle qui y 
+ * était éventuellement.
+ * @param type Le servo.
+ * @param valeur La valeur, sur 10 bits (voir i2cDeposeValeurServoPrecise).
+ */
+static void emetteurEmet(CommandeType type, unsigned int valeur) {
+    i2cDeposeValeurServoPrecise(EMETTEUR_ADRESSE, type, valeur);
+    emetteurDemarre();
+}
+
+/**
+ * Demande la lecture des registres d'état du récepteur (voir
+ * RegistreEtat). Le résultat est disponible avec i2cLitLecture.
+ * À appeler depuis la boucle principale.
+ */
+void emetteurDemandeEtat() {
+    // Les interruptions remplissent aussi la file d'émission:
+    INTCONbits.GIEL = 0;
+    i2cPrepareLecture(MODULE_SERVO, ETAT_VERSION, I2C_NOMBRE_REGISTRES_ETAT);
+    emetteurDemarre();
+    INTCONbits.GIEL = 1;
+}
+
+/** Écart minimum avec la dernière valeur émise pour émettre à nouveau. */
+#ifndef EMETTEUR_ZONE_MORTE
+#define EMETTEUR_ZONE_MORTE 2
+#endif
+
+/**
+ * Indique si la nouvelle valeur s'est suffisamment éloignée de la 
+ * référence pour être émise.
+ * @param valeur La nouvelle valeur.
+ * @param reference La dernière valeur émise.
+ * @return 255 si l'écart dépasse la zone morte.
+ */
+unsigned char emetteurHorsZoneMorte(unsigned char valeur, unsigned char reference) {
+    unsigned char ecart;
+    if (valeur > reference) {
+        ecart = valeur - reference;
+    } else {
+        ecart = reference - valeur;
+    }
+    if (ecart > EMETTEUR_ZONE_MORTE) {
+        return 255;
+    }
+    return 0;
+}
+
+#ifdef EMETTEUR_FILTRE
+/** Un filtre par canal. */
+static Filtre filtre[I2C_NOMBRE_DE_CANAUX];
+
+/**
+ * Rend le résultat complet de la dernière conversion.
+ * @return Une valeur de 10 bits (ADFM = 1).
+ */
+static unsigned int emetteurConversion() {
+    return ((unsigned int) ADRESH << 8) | ADRESL;
+}
+#endif
+
+#ifdef EMETTEUR_BALAYAGE
+/** Entrée analogique de chaque canal, à partir de SERVO1. */
+static const unsigned char entreeAnalogique[I2C_NOMBRE_DE_CANAUX] = {
+    9,      // AN9 sur RB3.
+    13      // AN13 sur RB5.
+};
+
+/** Dernière valeur émise pour chaque canal. */
+static unsigned char valeurEmise[I2C_NOMBRE_DE_CANAUX];
+
+/** Un bit par canal dont une valeur a déjà été émise. */
+static unsigned char valeurConnue = 0;
+
+/** Canal en cours de conversion. */
+static unsigned char canalBalaye = 0;
+
+/**
+ * Émet la valeur du canal en cours si elle a suffisamment changé. La
+ * zone morte compte en valeurs de 8 bits.
+ * @param valeur Nouvelle valeur du canal, sur 10 bits.
+ */
+static void emetteurBalayageCompare(unsigned int valeur) {
+    unsigned char masque = 1 << canalBalaye;
+    if (!(valeurConnue & masque) 
+            || emetteurHorsZoneMorte(valeur >> 2, valeurEmise[canalBalaye])) {
+        valeurConnue |= masque;
+        valeurEmise[canalBalaye] = valeur >> 2;
+        emetteurEmet(SERVO1 + canalBalaye, valeur);
+    }
+}
 
 /**
- * Point d'entrée des interruptions pour l'émetteur.caca
+ * Traite la conversion du canal en cours, et passe au canal suivant.
+ */
+static void emetteurBalayage() {
+#ifdef EMETTEUR_FILTRE
+    if (filtreAjoute(&filtre[canalBalaye], emetteurConversion())) {
+        emetteurBalayageCompare(filtreValeur(&filtre[canalBalaye]) >> 2);
+    }
+#else
+    emetteurBalayageCompare((unsigned int) ADRESH << 2);
+#endif
+    if (++canalBalaye >= I2C_NOMBRE_DE_CANAUX) {
+        canalBalaye = 0;
+    }
+    // Le changement d'entrée laisse le temps d'acquisition
+    // jusqu'à la prochaine conversion:
+    ADCON0bits.CHS = entreeAnalogique[canalBalaye];
+}
+#endif
+
+/**
+ * Point d'entrée des interruptions pour l'émetteur.
  */
 void emetteurInterruptions() {
 
+#if defined(EMETTEUR_CAPTURE)
+    unsigned char nouveaux;
+    
+#ifdef TRACE
+    if (PIR2bits.CCP2IF || PIR4bits.CCP5IF) {
+        TRACE_ENREGISTRE(traceBasse, TRACE_CAPTURE);
+    }
+#endif
+    nouveaux = captureInterruptions();
+    if (nouveaux & 1) {
+        emetteurEmet(SERVO1, (unsigned int) pwmValeurCapturee(0) << 2);
+    }
+    if (nouveaux & 2) {
+        emetteurEmet(SERVO2, (unsigned int) pwmValeurCapturee(1) << 2);
+    }
+#elif defined(EMETTEUR_BALAYAGE)
+    if (INTCONbits.TMR0IF) {
+        TRACE_ENREGISTRE(traceBasse, TRACE_TMR0IF);
+        INTCONbits.TMR0IF = 0;
+        ADCON0bits.GO = 1;
+    }
+    
+    if (PIR1bits.ADIF) {
+        TRACE_ENREGISTRE(traceBasse, TRACE_ADIF);
+        PIR1bits.ADIF = 0;
+        emetteurBalayage();
+    }
+#else
     static CommandeType commandeType;
     
     if (INTCON3bits.INT1F) {
+        TRACE_ENREGISTRE(traceBasse, TRACE_INT1F);
         INTCON3bits.INT1F = 0;
         commandeType = SERVO1;
+#ifdef EMETTEUR_FILTRE
+        filtreReinitialise(&filtre[0]);
+#endif
         ADCON0bits.GO = 1;
     }
     
     if (INTCON3bits.INT2F) {
+        TRACE_ENREGISTRE(traceBasse, TRACE_INT2F);
         INTCON3bits.INT2F = 0;
         commandeType = SERVO2;
+#ifdef EMETTEUR_FILTRE
+        filtreReinitialise(&filtre[1]);
+#endif
         ADCON0bits.GO = 1;
     }
     
     if (PIR1bits.ADIF) {
+        TRACE_ENREGISTRE(traceBasse, TRACE_ADIF);
         PIR1bits.ADIF = 0;
-        i2cPrepareCommandePourEmission(MODULE_SERVO, commandeType, ADRESH);
-        SSP1CON2bits.SEN = 1;
+#ifdef EMETTEUR_FILTRE
+        // Enchaîne les conversions jusqu'à obtenir une valeur filtrée:
+        if (filtreAjoute(&filtre[commandeType - SERVO1], emetteurConversion())) {
+            emetteurEmet(commandeType, filtreValeur(&filtre[commandeType - SERVO1]) >> 2);
+        } else {
+            ADCON0bits.GO = 1;
+        }
+#else
+        emetteurEmet(commandeType, (unsigned int) ADRESH << 2);
+#endif
     }
+#endif
     
     if (PIR1bits.SSP1IF) {
+        TRACE_ENREGISTRE(traceBasse, TRACE_SSP1IF);
         if (SSP1STATbits.P) {
             if (i2cDonneesDisponiblesPourEmission()) {
                 SSP1CON2bits.SEN = 1;
+            } else {
+                emissionEnCours = 0;
             }
         } else {
-            if (SSP1STATbits.BF == 0) {
-                if (i2cCommandeCompletementEmise()) {
+            switch (i2cOperationMaitre()) {
+                case I2C_EMET:
+                    if (SSP1STATbits.BF == 0) {
+                        SSP1BUF = i2cRecupereCaracterePourEmission();
+                    }
+                    break;
+                case I2C_REDEMARRE:
+                    // Lecture, ou commande suivante sans STOP:
+                    SSP1CON2bits.RSEN = 1;
+                    break;
+                case I2C_RECOIT:
+                    SSP1CON2bits.RCEN = 1;
+                    break;
+                case I2C_ACQUITTE:
+                    // Acquitte chaque octet reçu, sauf le dernier:
+                    SSP1CON2bits.ACKDT = i2cReceptionLecture(SSP1BUF) ? 0 : 1;
+                    SSP1CON2bits.ACKEN = 1;
+                    break;
+                default:
                     SSP1CON2bits.PEN = 1;
-                } else {
-                    SSP1BUF = i2cRecupereCaracterePourEmission();
-                }
+                    break;
             }
         }
         PIR1bits.SSP1IF = 0;
@@ -50,6 +293,27 @@ void emetteurInterruptions() {
  */
 static void emetteurInitialiseHardware() {
     
+#if defined(EMETTEUR_CAPTURE)
+    captureInitialiseHardware();
+#elif defined(EMETTEUR_BALAYAGE)
+    // Temporisateur 0 cadence les conversions (une toutes les 4ms):
+    T0CONbits.T08BIT = 1;       // Temporisateur de 8 bits.
+    T0CONbits.T0CS = 0;         // Source: FOSC / 4.
+#if EMETTEUR_LOG2_DIVISEUR_TMR0 == 0
+    T0CONbits.PSA = 1;          // Pas de diviseur de fréquence.
+#else
+    T0CONbits.PSA = 0;          // Utilise le diviseur de fréquence...
+    T0CONbits.T0PS = EMETTEUR_LOG2_DIVISEUR_TMR0 - 1;
+#endif
+    T0CONbits.TMR0ON = 1;       // Active le temporisateur.
+
+    INTCONbits.TMR0IE = 1;      // Active les interruptions ...
+    INTCON2bits.TMR0IP = 0;     // ... de basse priorité ...
+    INTCONbits.TMR0IF = 0;      // ... pour le temporisateur 0.
+
+    TRISBbits.RB5 = 1;          // Active RB5 comme entrée...
+    ANSELBbits.ANSB5 = 1;       // ... analogique AN13.
+#else
     // Interruptions INT1 et INT2:
     TRISBbits.RB1 = 1;          // Port RB1 comme entrée...
     ANSELBbits.ANSB1 = 0;       // ... digitale.
@@ -61,18 +325,25 @@ static void emetteurInitialiseHardware() {
     WPUBbits.WPUB2 = 1;         // ... et INT2.
     
     INTCON3bits.INT1E = 1;      // INT1
+    INTCON3bits.INT1IP = 0;     // Basse priorité (haute par défaut).
     INTCON2bits.INTEDG1 = 0;    // Flanc descendant.
     INTCON3bits.INT2E = 1;      // INT2
+    INTCON3bits.INT2IP = 0;     // Basse priorité (haute par défaut).
     INTCON2bits.INTEDG2 = 0;    // Flanc descendant.
+#endif
 
     // Active le module de conversion A/D:
     TRISBbits.RB3 = 1;      // Active RB4 comme entrée.
     ANSELBbits.ANSB3 = 1;   // Active AN11 comme entrée analogique.
     ADCON0bits.ADON = 1;    // Allume le module A/D.
     ADCON0bits.CHS = 9;     // Branche le convertisseur sur AN09
+#ifdef EMETTEUR_FILTRE
+    ADCON2bits.ADFM = 1;    // Les 10 bits, alignés à droite.
+#else
     ADCON2bits.ADFM = 0;    // Les 8 bits plus signifiants sur ADRESH.
-    ADCON2bits.ACQT = 3;    // Temps d'acquisition à 6 TAD.
-    ADCON2bits.ADCS = 0;    // À 1MHz, le TAD est à 2us.
+#endif
+    ADCON2bits.ACQT = HORLOGE_ACQT; // Temps d'acquisition de 12us.
+    ADCON2bits.ADCS = HORLOGE_ADCS; // TAD le plus court permis.
 
     PIE1bits.ADIE = 1;      // Active les interruptions A/D
     IPR1bits.ADIP = 0;      // Interruptions A/D sont de basse priorité.
@@ -88,7 +359,8 @@ static void emetteurInitialiseHardware() {
     SSP1CON3bits.PCIE = 1;      // Active l'interruption en cas STOP.
     SSP1CON3bits.SCIE = 1;      // Active l'interruption en cas de START.
     SSP1CON1bits.SSPM = 0b1000; // SSP1 en mode maître I2C.
-    SSP1ADD = 3;                // FSCL = FOSC / (4 * (SSP1ADD + 1)) = 62500 Hz.
+    SSP1ADD = HORLOGE_SSP1ADD;  // FSCL = FOSC / (4 * (SSP1ADD + 1)).
+    SSP1STATbits.SMP = HORLOGE_SMP;
 
     PIE1bits.SSP1IE = 1;        // Interruption en cas de transmission I2C...
     IPR1bits.SSP1IP = 0;        // ... de basse priorité.
@@ -100,12 +372,90 @@ static void emetteurInitialiseHardware() {
 }
 
 /**
- * Point d'entrée pour l'émetteur de radio contrôle.
+ * Initialise le hardware et les modules de l'émetteur.
  */
-void emetteurMain(void) {
+void emetteurInitialise(void) {
     emetteurInitialiseHardware();
     i2cReinitialise();
     pwmReinitialise();
+    emissionEnCours = 0;
+#ifdef EMETTEUR_BALAYAGE
+    valeurConnue = 0;
+    canalBalaye = 0;
+#ifdef EMETTEUR_FILTRE
+    for (canalBalaye = 0; canalBalaye < I2C_NOMBRE_DE_CANAUX; canalBalaye++) {
+        filtreReinitialise(&filtre[canalBalaye]);
+    }
+    canalBalaye = 0;
+#endif
+    ADCON0bits.CHS = entreeAnalogique[0];
+#endif
+}
+
+#ifndef TRACE
+/**
+ * Met l'émetteur en veille jusqu'à la prochaine interruption.
+ * Le SOMMEIL arrête l'oscillateur: il n'est possible que si aucune
+ * conversion (TAD dérivé de FOSC) ni aucune transaction I2C n'est en
+ * cours. Avec EMETTEUR_BALAYAGE ou EMETTEUR_CAPTURE, les temporisateurs
+ * 0 et 3 doivent continuer: l'émetteur se contente du REPOS.
+ * Toutes les interruptions de l'émetteur sont de basse priorité: 
+ * masquer GIEL suffit pour que l'état vérifié ne change pas avant SLEEP.
+ */
+static void emetteurAttend() {
+    INTCONbits.GIEL = 0;
+#if defined(EMETTEUR_BALAYAGE) || defined(EMETTEUR_CAPTURE)
+    veilleAttend(VEILLE_REPOS);
+#else
+    if (emissionEnCours || ADCON0bits.GO) {
+        veilleAttend(VEILLE_REPOS);
+    } else {
+        veilleAttend(VEILLE_SOMMEIL);
+    }
+#endif
+    INTCONbits.GIEL = 1;
+}
+#endif
+
+/**
+ * Point d'entrée pour l'émetteur de radio contrôle.
+ */
+void emetteurMain(void) {
+#ifdef TRACE
+    unsigned char etat[I2C_LECTURE_TAILLE];
+    unsigned char nombre;
+#endif
+
+    emetteurInitialise();
+
+    while(1) {
+#ifdef TRACE
+        // La console de trace est scrutée: pas de veille avec TRACE.
+        if (traceConsole() == 'E') {
+            emetteurDemandeEtat();
+        }
+        nombre = i2cLitLecture(etat);
+        if (nombre) {
+            traceOctets("ETAT", etat, nombre);
+        }
+#else
+        emetteurAttend();
+#endif
+    }
+}
+
+#ifdef TEST
+void testZoneMorte() {
+    testeEgaliteEntiers("EMZ01", emetteurHorsZoneMorte(100, 100), 0);
+    testeEgaliteEntiers("EMZ02", emetteurHorsZoneMorte(100 + EMETTEUR_ZONE_MORTE, 100), 0);
+    testeEgaliteEntiers("EMZ03", emetteurHorsZoneMorte(100 - EMETTEUR_ZONE_MORTE, 100), 0);
+    testeEgaliteEntiers("EMZ04", emetteurHorsZoneMorte(100 + EMETTEUR_ZONE_MORTE + 1, 100), 255);
+    testeEgaliteEntiers("EMZ05", emetteurHorsZoneMorte(100 - EMETTEUR_ZONE_MORTE - 1, 100), 255);
+    testeEgaliteEntiers("EMZ06", emetteurHorsZoneMorte(255, 0), 255);
+    testeEgaliteEntiers("EMZ07", emetteurHorsZoneMorte(0, 255), 255);
+}
 
-    while(1);
+void testEmetteur() {
+    testZoneMorte();
 }
+#endif
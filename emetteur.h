@@ -2,6 +2,12 @@
 #define EMETTEUR__H
 
 void emetteurInterruptions();
+void emetteurInitialise(void);
+void emetteurDemandeEtat();
 void emetteurMain(void);
 
+#ifdef TEST
+void testEmetteur();
+#endif
+
 #endif
\ No newline at end of file
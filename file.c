@@ -3,36 +3,36 @@
 
 /**
  * Si il y a de la place dans la file, enfile un caractère.
+ * Autrement, le caractère est compté comme rejeté.
+ * Ne doit être appelée que par le producteur.
  * @param c Le caractère.
  */
 void fileEnfile(File *file, char c) {
-    file->fileVide = 0;
-    if (!file->filePleine) {
-        file->file[file->fileEntree++] = c;
-        if (file->fileEntree >= FILE_TAILLE) {
-            file->fileEntree = 0;
-        }
-        if (file->fileEntree == file->fileSortie) {
-            file->filePleine = 255;
+    unsigned char entree = file->fileEntree;
+    unsigned char occupation = (unsigned char) (entree - file->fileSortie);
+    if (occupation < FILE_TAILLE) {
+        file->file[entree & FILE_MASQUE] = c;
+        file->fileEntree = entree + 1;
+        file->enfiles++;
+        if (occupation >= file->maximum) {
+            file->maximum = occupation + 1;
         }
+    } else {
+        file->rejetes++;
     }
 }
 
 /**
  * Si la file n'est pas vide, défile un caractère.
+ * Ne doit être appelée que par le consommateur.
  * @return Le caractère défilé, ou 0 si la file est vide.
  */
 char fileDefile(File *file) {
     char c;
-    file->filePleine = 0;
-    if (!file->fileVide) {
-        c = file->file[file->fileSortie++];
-        if (file->fileSortie >= FILE_TAILLE) {
-            file->fileSortie = 0;
-        }
-        if (file->fileSortie == file->fileEntree) {
-            file->fileVide = 255;
-        }
+    unsigned char sortie = file->fileSortie;
+    if (sortie != file->fileEntree) {
+        c = file->file[sortie & FILE_MASQUE];
+        file->fileSortie = sortie + 1;
         return c;
     }
     return 0;
@@ -40,31 +40,61 @@ char fileDefile(File *file) {
 
 /**
  * Indique si la file est vide.
+ * @return 255 si la file est vide, 0 autrement.
  */
 char fileEstVide(File *file) {
-    return file->fileVide;
+    if (file->fileEntree == file->fileSortie) {
+        return 255;
+    }
+    return 0;
 }
 
 /**
  * Indique si la file est pleine.
+ * @return 255 si la file est pleine, 0 autrement.
  */
 char fileEstPleine(File *file) {
-    return file->filePleine;
+    if ((unsigned char) (file->fileEntree - file->fileSortie) >= FILE_TAILLE) {
+        return 255;
+    }
+    return 0;
+}
+
+/**
+ * Indique combien de caractères peuvent encore être enfilés.
+ * Appelée par le producteur, le résultat est fiable car le consommateur
+ * ne peut que libérer de la place.
+ * @return Le nombre de places libres.
+ */
+unsigned char fileEspaceDisponible(File *file) {
+    return FILE_TAILLE - (unsigned char) (file->fileEntree - file->fileSortie);
+}
+
+/**
+ * Compte des caractères que le producteur n'a pas enfilés, parce que
+ * la file n'avait pas la place pour un message complet.
+ * Ne doit être appelée que par le producteur.
+ * @param nombre Le nombre de caractères rejetés.
+ */
+void fileRejette(File *file, unsigned char nombre) {
+    file->rejetes += nombre;
 }
 
 /**
- * Vide et réinitialise la file.
+ * Vide et réinitialise la file, ainsi que ses compteurs.
+ * Ni le producteur ni le consommateur ne doivent être actifs.
  */
 void fileReinitialise(File *file) {
     file->fileEntree = 0;
     file->fileSortie = 0;
-    file->fileVide = 255;
-    file->filePleine = 0;
+    file->enfiles = 0;
+    file->rejetes = 0;
+    file->maximum = 0;
 }
 
 #ifdef TEST
 void testEnfileEtDefile() {
-    File file;
+    File file = {0};
     fileReinitialise(&file);
     
     testeEgaliteEntiers("FIL01", fileEstVide(&file), 255);    
@@ -79,10 +109,14 @@ void testEnfileEtDefile() {
     testeEgaliteEntiers("FIL06", fileDefile(&file), 20);
     testeEgaliteEntiers("FIL07", fileEstVide(&file), 255);
     testeEgaliteEntiers("FIL08", fileDefile(&file), 0);
+    testeEgaliteEntiers("FIL09", fileEspaceDisponible(&file), FILE_TAILLE);
+    
+    fileEnfile(&file, 30);
+    testeEgaliteEntiers("FIL10", fileEspaceDisponible(&file), FILE_TAILLE - 1);
 }
 
 void testEnfileEtDefileBeaucoupDeCaracteres() {
-    File file;
+    File file = {0};
     int n = 0;
     char c = 0;
     
@@ -98,7 +132,7 @@ void testEnfileEtDefileBeaucoupDeCaracteres() {
 }
 
 void testDebordePuisRecupereLesCaracteres() {
-    File file;
+    File file = {0};
     char c = 1;
     
     fileReinitialise(&file);
@@ -118,9 +152,81 @@ void testDebordePuisRecupereLesCaracteres() {
     testeEgaliteEntiers("FDB003", c, FILE_TAILLE);
 }
 
-int testFile() {
+/**
+ * Fait travailler un producteur et un consommateur entrelacés au hasard,
+ * et vérifie qu'aucun caractère n'est perdu, dupliqué ou déplacé.
+ * Le générateur pseudo-aléatoire est un registre à décalage de 16 bits,
+ * pour que le test soit reproductible.
+ */
+void testProducteurConsommateurAleatoires() {
+    File file = {0};
+    unsigned int hasard = 0xACE1;
+    unsigned int n;
+    unsigned char produit = 0;
+    unsigned char consomme = 0;
+    
+    fileReinitialise(&file);
+
+    for (n = 0; n < 2000; n++) {
+        hasard = (hasard >> 1) ^ (-(hasard & 1) & 0xB400);
+        if (hasard & 1) {
+            if (!fileEstPleine(&file)) {
+                fileEnfile(&file, produit++);
+            }
+        } else {
+            if (!fileEstVide(&file)) {
+                if (testeEgaliteEntiers("FPC001", (unsigned char) fileDefile(&file), consomme++)) {
+                    return;
+                }
+            }
+        }
+        if (testeEgaliteEntiers("FPC002", (unsigned char) (produit - consomme) <= FILE_TAILLE, 1)) {
+            return;
+        }
+    }
+
+    while (!fileEstVide(&file)) {
+        if (testeEgaliteEntiers("FPC003", (unsigned char) fileDefile(&file), consomme++)) {
+            return;
+        }
+    }
+    testeEgaliteEntiers("FPC004", consomme, produit);
+}
+
+void testCompteursFile() {
+    File file = {0};
+    unsigned char n;
+
+    fileReinitialise(&file);
+    fileEnfile(&file, 1);
+    fileEnfile(&file, 2);
+    fileDefile(&file);
+    fileEnfile(&file, 3);
+    testeEgaliteEntiers("FCO001", file.enfiles, 3);
+    testeEgaliteEntiers("FCO002", file.maximum, 2);
+    testeEgaliteEntiers("FCO003", file.rejetes, 0);
+
+    for (n = 0; n < FILE_TAILLE + 2; n++) {
+        fileEnfile(&file, n);
+    }
+    testeEgaliteEntiers("FCO004", file.enfiles, FILE_TAILLE + 1);
+    testeEgaliteEntiers("FCO005", file.maximum, FILE_TAILLE);
+    testeEgaliteEntiers("FCO006", file.rejetes, 4);
+
+    fileRejette(&file, 3);
+    testeEgaliteEntiers("FCO007", file.rejetes, 7);
+
+    fileReinitialise(&file);
+    testeEgaliteEntiers("FCO008", file.enfiles, 0);
+    testeEgaliteEntiers("FCO009", file.maximum, 0);
+    testeEgaliteEntiers("FCO010", file.rejetes, 0);
+}
+
+void testFile() {
     testEnfileEtDefile();
     testEnfileEtDefileBeaucoupDeCaracteres();
     testDebordePuisRecupereLesCaracteres();
+    testProducteurConsommateurAleatoires();
+    testCompteursFile();
 }
 #endif
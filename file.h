@@ -1,33 +1,58 @@
 #ifndef FILE_H
 #define	FILE_H
 
-#define FILE_TAILLE 10
-
+/**
+ * Capacité de la file. Doit être une puissance de 2 (et diviser 256),
+ * pour que le retour au début de la file se fasse avec un simple masque.
+ */
+#define FILE_TAILLE 16
+#define FILE_MASQUE (FILE_TAILLE - 1)
+
+/**
+ * File circulaire à un seul producteur et un seul consommateur.
+ * Le producteur (par exemple une interruption) ne modifie que
+ * <code>fileEntree</code>, et le consommateur (par exemple la boucle
+ * principale) ne modifie que <code>fileSortie</code>. Comme chaque
+ * pointeur tient sur un octet, sa lecture et son écriture sont
+ * atomiques, et il n'est pas nécessaire de masquer les interruptions.
+ * Les pointeurs ne sont jamais ramenés à zéro: ils débordent
+ * naturellement à 256, et leur différence donne le nombre de
+ * caractères dans la file.
+ */
 typedef struct {
     /** Espace de mémoire pour stocker la file. */
     char file[FILE_TAILLE];
 
-    /** Pointeur d'entrée de la file. */
-    unsigned char fileEntree;
+    /** Pointeur d'entrée de la file. Modifié seulement par le producteur. */
+    volatile unsigned char fileEntree;
+
+    /** Pointeur de sortie de la file. Modifié seulement par le consommateur. */
+    volatile unsigned char fileSortie;
 
-    /** Pointeur de sortie de la file. */
-    unsigned char fileSortie;
+    /**
+     * Compteurs de télémétrie, modifiés seulement par le producteur.
+     * Les compteurs de 16 bits reviennent à 0 après 65535.
+     */
+    /** Nombre de caractères enfilés. */
+    unsigned int enfiles;
 
-    /** Indique si la file est vide. */
-    char fileVide;
+    /** Nombre de caractères rejetés faute de place. */
+    unsigned int rejetes;
 
-    /** Indique si la file est pleine. */
-    char filePleine;
+    /** Occupation maximum atteinte depuis la réinitialisation. */
+    unsigned char maximum;
 } File;
 
 void fileEnfile(File *file, char c);
 char fileDefile(File *file);
 char fileEstVide(File *file);
 char fileEstPleine(File *file);
+unsigned char fileEspaceDisponible(File *file);
+void fileRejette(File *file, unsigned char nombre);
 void fileReinitialise(File *file);
 
 #ifdef TEST
-int testFile();
+void testFile();
 #endif
 
 #endif
@@ -0,0 +1,118 @@
+#include "filtre.h"
+#include "test.h"
+
+/**
+ * Ajoute un échantillon de 10 bits au filtre. Quand le filtre a reçu
+ * 2^FILTRE_LOG2_ECHANTILLONS échantillons, la somme est décimée 
+ * en une valeur de 12 bits, sans division.
+ * @param echantillon Un échantillon entre 0 et 1023.
+ * @return 255 si une nouvelle valeur filtrée est disponible.
+ */
+unsigned char filtreAjoute(Filtre *filtre, unsigned int echantillon) {
+    filtre->somme += echantillon;
+    if (++filtre->nombre < (1 << FILTRE_LOG2_ECHANTILLONS)) {
+        return 0;
+    }
+#if FILTRE_LOG2_ECHANTILLONS >= 2
+    filtre->valeur = filtre->somme >> (FILTRE_LOG2_ECHANTILLONS - 2);
+#else
+    filtre->valeur = filtre->somme << (2 - FILTRE_LOG2_ECHANTILLONS);
+#endif
+    filtre->somme = 0;
+    filtre->nombre = 0;
+    return 255;
+}
+
+/**
+ * Rend la dernière valeur filtrée.
+ * @return Une valeur sur 12 bits, entre 0 et 4092.
+ */
+unsigned int filtreValeur(Filtre *filtre) {
+    return filtre->valeur;
+}
+
+/**
+ * Réinitialise le filtre.
+ */
+void filtreReinitialise(Filtre *filtre) {
+    filtre->somme = 0;
+    filtre->nombre = 0;
+    filtre->valeur = 0;
+}
+
+#ifdef TEST
+/*
+ * Les flux de référence ont 16 échantillons, et les valeurs attendues
+ * supposent FILTRE_LOG2_ECHANTILLONS à 4.
+ */
+
+/**
+ * Passe un flux d'échantillons dans le filtre.
+ * @return La dernière valeur filtrée, ou 0xFFFF si aucune.
+ */
+unsigned int filtreFlux(Filtre *filtre, const unsigned int *flux, unsigned char longueur) {
+    unsigned int valeur = 0xFFFF;
+    while (longueur--) {
+        if (filtreAjoute(filtre, *flux++)) {
+            valeur = filtreValeur(filtre);
+        }
+    }
+    return valeur;
+}
+
+/** Entrée stable à mi-course, avec un bruit de +/- 1 LSB. */
+static const unsigned int fluxBruitMiCourse[16] = {
+    512, 513, 511, 512, 513, 512, 511, 511,
+    512, 513, 512, 512, 511, 513, 512, 512
+};
+
+/** Entrée entre deux codes: le filtre retrouve les bits perdus. */
+static const unsigned int fluxEntreDeuxCodes[16] = {
+    300, 301, 300, 301, 301, 300, 301, 300,
+    300, 301, 300, 301, 301, 300, 301, 300
+};
+
+/** Entrée au maximum, pour vérifier que la somme ne déborde pas. */
+static const unsigned int fluxMaximum[16] = {
+    1023, 1023, 1023, 1023, 1023, 1023, 1023, 1023,
+    1023, 1023, 1023, 1023, 1023, 1023, 1023, 1023
+};
+
+/** Un pic isolé est atténué 16 fois. */
+static const unsigned int fluxPic[16] = {
+    200, 200, 200, 200, 200, 200, 200, 200,
+    1000, 200, 200, 200, 200, 200, 200, 200
+};
+
+void testFiltreFlux() {
+    Filtre filtre;
+
+    filtreReinitialise(&filtre);
+    testeEgaliteEntiers("FLT01", filtreFlux(&filtre, fluxBruitMiCourse, 15), 0xFFFF);
+    testeEgaliteEntiers("FLT02", filtreFlux(&filtre, &fluxBruitMiCourse[15], 1), 2048);
+
+    filtreReinitialise(&filtre);
+    testeEgaliteEntiers("FLT03", filtreFlux(&filtre, fluxEntreDeuxCodes, 16), 1202);
+
+    filtreReinitialise(&filtre);
+    testeEgaliteEntiers("FLT04", filtreFlux(&filtre, fluxMaximum, 16), 4092);
+
+    filtreReinitialise(&filtre);
+    testeEgaliteEntiers("FLT05", filtreFlux(&filtre, fluxPic, 16), 1000);
+}
+
+void testFiltrePeriodesSuccessives() {
+    Filtre filtre;
+
+    filtreReinitialise(&filtre);
+    filtreFlux(&filtre, fluxMaximum, 16);
+    testeEgaliteEntiers("FLTS01", filtreFlux(&filtre, fluxBruitMiCourse, 16), 2048);
+    testeEgaliteEntiers("FLTS02", filtreFlux(&filtre, fluxMaximum, 8), 0xFFFF);
+    testeEgaliteEntiers("FLTS03", filtreValeur(&filtre), 2048);
+}
+
+void testFiltre() {
+    testFiltreFlux();
+    testFiltrePeriodesSuccessives();
+}
+#endif
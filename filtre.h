@@ -0,0 +1,36 @@
+#ifndef FILTRE__H
+#define FILTRE__H
+
+/**
+ * Nombre d'échantillons par valeur filtrée, en puissance de 2.
+ * Avec 4 (16 échantillons), on gagne 2 bits de résolution.
+ * Au maximum 6, pour que la somme tienne sur 16 bits.
+ */
+#ifndef FILTRE_LOG2_ECHANTILLONS
+#define FILTRE_LOG2_ECHANTILLONS 4
+#endif
+
+#if FILTRE_LOG2_ECHANTILLONS > 6
+#error "Au-delà de 6, la somme des échantillons déborde de 16 bits"
+#endif
+
+typedef struct {
+    /** Somme des échantillons de la période en cours. */
+    unsigned int somme;
+
+    /** Nombre d'échantillons dans la période en cours. */
+    unsigned char nombre;
+
+    /** Dernière valeur filtrée, sur 12 bits. */
+    unsigned int valeur;
+} Filtre;
+
+unsigned char filtreAjoute(Filtre *filtre, unsigned int echantillon);
+unsigned int filtreValeur(Filtre *filtre);
+void filtreReinitialise(Filtre *filtre);
+
+#ifdef TEST
+void testFiltre();
+#endif
+
+#endif
@@ -0,0 +1,13 @@
+#include <xc.h>
+#include "horloge.h"
+
+/**
+ * Règle l'oscillateur interne selon HORLOGE_MHZ, et attend qu'il soit
+ * stable. À appeler en premier: les autres initialisations supposent
+ * que FOSC a déjà sa valeur définitive.
+ */
+void horlogeInitialise() {
+    OSCCONbits.IRCF = HORLOGE_IRCF;
+    OSCTUNEbits.PLLEN = HORLOGE_PLL;
+    while (!OSCCONbits.HFIOFS);
+}
@@ -0,0 +1,94 @@
+#ifndef HORLOGE__H
+#define HORLOGE__H
+
+/**
+ * Profil d'horloge: HORLOGE_MHZ choisit la fréquence de l'oscillateur
+ * interne (HFINTOSC), et tous les réglages qui en dépendent sont 
+ * dérivés ici: diviseurs des temporisateurs, TAD du convertisseur,
+ * fréquence du bus I2C et vitesse de la EUSART.
+ *
+ * MHz  IRCF  PLL  cycle   TAD  TMR1/TMR3          TMR2 (PWM CCP)
+ * 1    011   non  4us     2us  1:1, pas de 4us    1:4
+ * 4    101   non  1us     1us  1:4, pas de 4us    1:16
+ * 16   111   non  250ns   1us  1:8, pas de 2us    impossible
+ * 64   111   oui  62,5ns  1us  1:8, pas de 0,5us  impossible
+ *
+ * Les valeurs PWM (pwm.c) restent en pas de 4us. Au-delà de 4MHz, le
+ * temporisateur 2 ne peut plus couvrir une période de 2ms (PR2 et son
+ * diviseur sont limités à 255 et 1:16): seul le séquenceur 
+ * (PWM_SEQUENCEUR) génère les impulsions, et les temporisateurs 1 et 3
+ * comptent HORLOGE_PAS_PAR_4US pas pour 4us.
+ * Les temporisateurs 1 (banc de cycles) et 5 (trace, latence) comptent
+ * toujours des cycles d'instruction, dont la durée dépend du profil.
+ */
+#ifndef HORLOGE_MHZ
+#define HORLOGE_MHZ 1
+#endif
+
+/**
+ * Fréquence du bus I2C, en kHz: 100 (mode standard) ou 400 (mode 
+ * rapide). Le maître ne peut pas descendre sous SSP1ADD = 3: à 1MHz,
+ * le bus est limité à 62,5kHz, et à 4MHz à 250kHz.
+ * L'esclave doit suivre: en mode rapide, le récepteur a intérêt à
+ * tourner au moins à 16MHz.
+ */
+#ifndef HORLOGE_I2C_KHZ
+#define HORLOGE_I2C_KHZ 100
+#endif
+
+/** Vitesse de la EUSART (tests, trace et banc de cycles), en bauds. */
+#ifndef HORLOGE_BAUDS
+#define HORLOGE_BAUDS 9600
+#endif
+
+#if HORLOGE_MHZ == 1
+#define HORLOGE_IRCF 0b011
+#define HORLOGE_PLL 0
+#define HORLOGE_ADCS 0b000          // FOSC/2: TAD de 2us.
+#define HORLOGE_ACQT 3              // 6 TAD, soit 12us.
+#define HORLOGE_T13CKPS 0           // 1:1
+#define HORLOGE_PAS_PAR_4US 1
+#define HORLOGE_T2CKPS 1            // 1:4
+#define HORLOGE_LOG2_MHZ 0
+#elif HORLOGE_MHZ == 4
+#define HORLOGE_IRCF 0b101
+#define HORLOGE_PLL 0
+#define HORLOGE_ADCS 0b100          // FOSC/4: TAD de 1us.
+#define HORLOGE_ACQT 5              // 12 TAD, soit 12us.
+#define HORLOGE_T13CKPS 2           // 1:4
+#define HORLOGE_PAS_PAR_4US 1
+#define HORLOGE_T2CKPS 2            // 1:16
+#define HORLOGE_LOG2_MHZ 2
+#elif HORLOGE_MHZ == 16
+#define HORLOGE_IRCF 0b111
+#define HORLOGE_PLL 0
+#define HORLOGE_ADCS 0b101          // FOSC/16: TAD de 1us.
+#define HORLOGE_ACQT 5              // 12 TAD, soit 12us.
+#define HORLOGE_T13CKPS 3           // 1:8
+#define HORLOGE_PAS_PAR_4US 2
+#define HORLOGE_LOG2_MHZ 4
+#elif HORLOGE_MHZ == 64
+#define HORLOGE_IRCF 0b111
+#define HORLOGE_PLL 1
+#define HORLOGE_ADCS 0b110          // FOSC/64: TAD de 1us.
+#define HORLOGE_ACQT 5              // 12 TAD, soit 12us.
+#define HORLOGE_T13CKPS 3           // 1:8
+#define HORLOGE_PAS_PAR_4US 8
+#define HORLOGE_LOG2_MHZ 6
+#else
+#error "HORLOGE_MHZ doit valoir 1, 4, 16 ou 64"
+#endif
+
+/** FSCL = FOSC / (4 * (SSP1ADD + 1)); 0 à 2 sont interdits en maître. */
+#define HORLOGE_SSP1ADD_EXACT (HORLOGE_MHZ * 1000UL / (4UL * HORLOGE_I2C_KHZ) - 1)
+#define HORLOGE_SSP1ADD (HORLOGE_SSP1ADD_EXACT < 3 ? 3 : HORLOGE_SSP1ADD_EXACT)
+
+/** Contrôle de pente (SMP = 0) en mode rapide seulement. */
+#define HORLOGE_SMP (HORLOGE_I2C_KHZ > 100 ? 0 : 1)
+
+/** Avec BRGH = 1 et BRG16 = 1: bauds = FOSC / (4 * (SPBRG + 1)). */
+#define HORLOGE_SPBRG ((HORLOGE_MHZ * 1000000UL + 2UL * HORLOGE_BAUDS) / (4UL * HORLOGE_BAUDS) - 1)
+
+void horlogeInitialise();
+
+#endif
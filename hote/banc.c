@@ -0,0 +1,239 @@
+/**
+ * Banc d'essai du cœur du protocole, compilé sur l'ordinateur hôte.
+ * Mesure le coût par appel et le débit des fonctions qui sont sur le
+ * chemin des interruptions: la file, la machine d'états i2c et la
+ * conversion PWM.
+ *
+ * Les temps sont ceux de l'hôte, pas du PIC; ils ne servent qu'à
+ * comparer deux versions du code sur la même machine (voir
+ * 'make compare' dans hote/Makefile).
+ *
+ * Le résultat est une ligne par mesure:
+ *   <nom> <nanosecondes par appel> <appels par seconde>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "file.h"
+#include "i2c.h"
+#include "pwm.h"
+
+/** Nombre de répétitions par défaut de chaque mesure. */
+#define BANC_REPETITIONS 1000000UL
+
+/** Chaque mesure est refaite plusieurs fois, et la meilleure est gardée. */
+#define BANC_ESSAIS 5
+
+/** Pas déclarée dans pwm.h, car interne au module. */
+unsigned char pwmConversion(unsigned char valeurGenerique);
+
+/** Empêche le compilateur d'éliminer les appels mesurés. */
+static volatile unsigned char puits;
+
+static File file;
+
+/**
+ * Enfile puis défile un caractère.
+ * @return Le nombre d'appels effectués.
+ */
+static unsigned long bancFileEnfileDefile(unsigned long repetitions) {
+    unsigned long n;
+    fileReinitialise(&file);
+    for (n = 0; n < repetitions; n++) {
+        fileEnfile(&file, (char) n);
+        puits = fileDefile(&file);
+    }
+    return repetitions * 2;
+}
+
+/**
+ * Remplit la file, puis la vide.
+ */
+static unsigned long bancFileRemplitVide(unsigned long repetitions) {
+    unsigned long n;
+    unsigned char m;
+    fileReinitialise(&file);
+    for (n = 0; n < repetitions; n++) {
+        for (m = 0; m < FILE_TAILLE; m++) {
+            fileEnfile(&file, m);
+        }
+        for (m = 0; m < FILE_TAILLE; m++) {
+            puits = fileDefile(&file);
+        }
+    }
+    return repetitions * FILE_TAILLE * 2;
+}
+
+/**
+ * Émet une commande complète, comme le fait l'interruption de
+ * l'émetteur: un appel par octet émis.
+ */
+static unsigned long bancI2cEmission(unsigned long repetitions) {
+    unsigned long n, appels = 0;
+    i2cReinitialise();
+    for (n = 0; n < repetitions; n++) {
+        i2cPrepareCommandePourEmission(MODULE_SERVO, SERVO1, (unsigned char) n);
+        i2cDonneesDisponiblesPourEmission();
+        appels += 2;
+        while (!i2cCommandeCompletementEmise()) {
+            puits = i2cRecupereCaracterePourEmission();
+            appels += 2;
+        }
+        appels++;
+    }
+    return appels;
+}
+
+/**
+ * Dépose deux valeurs dans la boîte aux lettres, et émet la rafale.
+ */
+static unsigned long bancI2cBoiteAuxLettres(unsigned long repetitions) {
+    unsigned long n, appels = 0;
+    i2cReinitialise();
+    for (n = 0; n < repetitions; n++) {
+        i2cDeposeValeurServo(MODULE_SERVO, SERVO1, (unsigned char) n);
+        i2cDeposeValeurServo(MODULE_SERVO, SERVO2, (unsigned char) n);
+        i2cDonneesDisponiblesPourEmission();
+        appels += 3;
+        while (!i2cCommandeCompletementEmise()) {
+            puits = i2cRecupereCaracterePourEmission();
+            appels += 2;
+        }
+        appels++;
+    }
+    return appels;
+}
+
+/**
+ * Reçoit une rafale de deux valeurs, comme le fait l'interruption du
+ * récepteur, puis la lit comme le fait la boucle principale.
+ */
+static unsigned long bancI2cReception(unsigned long repetitions) {
+    unsigned long n;
+    Commande commande;
+    i2cReinitialise();
+    for (n = 0; n < repetitions; n++) {
+        i2cReceptionAdresse(MODULE_SERVO);
+        i2cReceptionDonnee(SERVO1);
+        i2cReceptionDonnee((unsigned char) n);
+        i2cReceptionDonnee((unsigned char) n);
+        i2cFinDeReception();
+        i2cLitCommandeRecue(&commande);
+        i2cLitCommandeRecue(&commande);
+        puits = commande.valeur;
+    }
+    return repetitions * 7;
+}
+
+/**
+ * Convertit toutes les valeurs génériques.
+ */
+static unsigned long bancPwmConversion(unsigned long repetitions) {
+    unsigned long n;
+    for (n = 0; n < repetitions; n++) {
+        puits = pwmConversion((unsigned char) n);
+    }
+    return repetitions;
+}
+
+/**
+ * Établit et publie une valeur, et génère les impulsions, comme le
+ * fait le récepteur.
+ */
+static unsigned long bancPwmEspacement(unsigned long repetitions) {
+    unsigned long n;
+    pwmReinitialise();
+    for (n = 0; n < repetitions; n++) {
+        pwmPrepareValeur(0);
+        pwmEtablitValeur((unsigned char) n);
+        pwmPublie();
+        if (pwmEspacement()) {
+            puits = pwmValeurPubliee(0);
+        }
+    }
+    return repetitions * 4;
+}
+
+/**
+ * Génère des trames pendant que tous les canaux se déplacent: le pire
+ * cas de l'interpolation. Une mesure par trame.
+ */
+static unsigned long bancPwmInterpolation(unsigned long repetitions) {
+    unsigned long n;
+    unsigned char canal;
+    pwmReinitialise();
+    for (canal = 0; canal < PWM_NOMBRE_DE_CANAUX; canal++) {
+        pwmPrepareValeur(canal);
+        pwmEtablitValeur(0);
+    }
+    pwmPublie();
+    while (!pwmEspacement());
+    for (n = 0; n < repetitions; n++) {
+        // À la vitesse 1, un aller prend plus de 1024 trames:
+        if ((n & 1023) == 0) {
+            for (canal = 0; canal < PWM_NOMBRE_DE_CANAUX; canal++) {
+                pwmPrepareValeur(canal);
+                pwmEtablitVitesse(1);
+                pwmEtablitValeur((n & 1024) ? 0 : 255);
+            }
+            pwmPublie();
+        }
+        while (!pwmEspacement());
+        puits = pwmValeurPubliee(0);
+    }
+    return repetitions;
+}
+
+typedef struct {
+    const char *nom;
+    unsigned long (*mesure)(unsigned long repetitions);
+} Banc;
+
+static const Banc bancs[] = {
+    {"fileEnfileDefile", bancFileEnfileDefile},
+    {"fileRemplitVide", bancFileRemplitVide},
+    {"i2cEmission", bancI2cEmission},
+    {"i2cBoiteAuxLettres", bancI2cBoiteAuxLettres},
+    {"i2cReception", bancI2cReception},
+    {"pwmConversion", bancPwmConversion},
+    {"pwmEspacement", bancPwmEspacement},
+    {"pwmInterpolation", bancPwmInterpolation}
+};
+
+static double secondes() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/**
+ * Exécute tous les bancs.
+ * Le premier argument optionnel est le nombre de répétitions.
+ */
+int main(int argc, char **argv) {
+    unsigned long repetitions = BANC_REPETITIONS;
+    unsigned long appels;
+    double debut, duree, meilleure;
+    unsigned int b, essai;
+
+    if (argc > 1) {
+        repetitions = strtoul(argv[1], NULL, 10);
+    }
+
+    printf("# banc ns/appel appels/s\n");
+    for (b = 0; b < sizeof(bancs) / sizeof(bancs[0]); b++) {
+        meilleure = 0;
+        appels = 0;
+        for (essai = 0; essai < BANC_ESSAIS; essai++) {
+            debut = secondes();
+            appels = bancs[b].mesure(repetitions);
+            duree = secondes() - debut;
+            if (essai == 0 || duree < meilleure) {
+                meilleure = duree;
+            }
+        }
+        printf("%s %.2f %.0f\n", bancs[b].nom,
+                meilleure * 1e9 / appels, appels / meilleure);
+    }
+    return 0;
+}
@@ -0,0 +1,11 @@
+# Compare deux résultats de banc.c: le premier fichier est la référence.
+# Affiche l'écart de chaque mesure, et échoue si une mesure est plus
+# lente de plus de 'tolerance' pour cent.
+/^#/ { next }
+NR == FNR { reference[$1] = $2; next }
+($1 in reference) {
+    ecart = 100 * ($2 - reference[$1]) / reference[$1]
+    printf "%s %.2f %.2f %+.1f%%%s\n", $1, reference[$1], $2, ecart, (ecart > tolerance ? " REGRESSION" : "")
+    if (ecart > tolerance) regression = 1
+}
+END { exit regression }
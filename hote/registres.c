@@ -0,0 +1,3 @@
+#include <xc.h>
+
+Registres registres;
@@ -0,0 +1,925 @@
+/**
+ * Co-simulation d'un émetteur et d'un récepteur reliés par I2C.
+ *
+ * Le micrologiciel réel (emetteurInterruptions, recepteurInterruptions,
+ * la boucle principale du récepteur) est exécuté sur deux contextes de
+ * registres, un par nœud: avant de faire avancer un nœud, ses registres
+ * sont copiés dans 'registres' (voir hote/xc.h), puis sauvegardés après.
+ * Les modules partagés (i2c.c, file.c, pwm.c) n'ont qu'une instance,
+ * mais l'émetteur n'utilise que la moitié émission de i2c.c et le
+ * récepteur que la moitié réception, donc ils ne se gênent pas.
+ *
+ * Sont modélisés, au cycle d'instruction près (4us à 1MHz, voir
+ * horloge.h pour les autres profils):
+ * - Les entrées de l'émetteur: flanc sur INT1 ou INT2 (ou, avec
+ *   EMETTEUR_BALAYAGE, simple changement de la tension analogique).
+ * - Le convertisseur A/D: durée selon ACQT et ADCS, ADRESH/ADRESL, ADIF.
+ * - Le temporisateur 0 (pour EMETTEUR_BALAYAGE) et le temporisateur 2.
+ * - Le MSSP maître et esclave: SEN, PEN, START, STOP, S, P, BF, DA,
+ *   SSP1BUF, ACKSTAT et SSPOV, à la fréquence fixée par SSP1ADD.
+ *   Pour les lectures: RSEN, RCEN, ACKEN, ACKDT, R_NOT_W, et CKP qui
+ *   retient l'horloge jusqu'à ce que l'esclave ait écrit SSP1BUF.
+ *   L'esclave répond aussi à l'appel général si GCEN est actif.
+ * - Les interruptions de haute et basse priorité. Le micrologiciel
+ *   s'exécute instantanément, mais chaque interruption et chaque
+ *   commande appliquée par la boucle principale occupent ensuite le
+ *   nœud pendant une durée estimée (options -i et -l), qu'on peut
+ *   mesurer sur le vrai matériel avec la trace (voir trace.h).
+ *
+ * Le récepteur compte les valeurs reçues sur le bus. Le débit maximum
+ * soutenu (option -b) est le plus grand débit d'entrées pour lequel
+ * toutes les valeurs arrivent au récepteur, sans débordement du MSSP.
+ *
+ * La latence est mesurée depuis le flanc d'entrée jusqu'à l'écriture de
+ * la nouvelle valeur dans CCPR1L (canal 1) ou CCPR3L (canal 2). Une
+ * valeur qui n'apparaît jamais sur la sortie, parce qu'une valeur plus
+ * récente l'a remplacée dans la boîte aux lettres de l'émetteur, est
+ * comptée comme perdue.
+ *
+ * Usage: simulation [options]
+ *   -m motif     regulier, rafale ou aleatoire (regulier par défaut).
+ *   -p periode   Cycles entre deux entrées (1000 par défaut).
+ *   -n nombre    Nombre d'entrées (1000 par défaut).
+ *   -c canaux    Nombre de canaux actifs, 1 ou 2 (2 par défaut).
+ *   -r taille    Taille des rafales du motif rafale (8 par défaut).
+ *   -i cycles    Durée d'une interruption (60 par défaut).
+ *   -l cycles    Durée d'application d'une commande (40 par défaut).
+ *   -b           Balaye les périodes pour trouver le débit maximum
+ *                soutenu sans perte.
+ *   -h           Affiche l'histogramme des latences.
+ *   -t           Affiche les compteurs de télémétrie du micrologiciel:
+ *                caractères enfilés, rejetés et occupation maximum
+ *                de chaque file, rafales émises et reçues, valeurs
+ *                remplacées dans la boîte aux lettres, et part
+ *                du temps de chaque nœud actif, au repos et en 
+ *                sommeil (voir veille.h), et, avec 
+ *                RECEPTEUR_MESURE_LATENCE, la latence du récepteur.
+ *   -e cycles    L'émetteur lit les registres d'état du récepteur
+ *                à cet intervalle (0, par défaut, pour jamais); -t
+ *                affiche le nombre de lectures, et de lectures dont
+ *                le contenu est incohérent.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xc.h>
+#include "file.h"
+#include "i2c.h"
+#include "pwm.h"
+#include "horloge.h"
+#include "emetteur.h"
+#include "recepteur.h"
+
+#ifdef PWM_SEQUENCEUR
+#error "La simulation observe CCPR1L et CCPR3L, et ne supporte pas PWM_SEQUENCEUR"
+#endif
+
+/** Durée d'un cycle d'instruction, en nanosecondes (voir horloge.h). */
+#define SIMULATION_NS_PAR_CYCLE (4000UL / HORLOGE_MHZ)
+
+/** Nombre de canaux observés: CCPR1L et CCPR3L. */
+#define SIMULATION_CANAUX 2
+
+/** Nombre maximum d'entrées par simulation. */
+#define SIMULATION_ENTREES_MAXIMUM 100000
+
+/** Les latences sont classées par tranches de 1ms. */
+#define SIMULATION_CLASSES 64
+
+/** Pas déclarée dans pwm.h, car interne au module. */
+unsigned char pwmConversion(unsigned char valeurGenerique);
+
+typedef enum {
+    REGULIER,
+    RAFALE,
+    ALEATOIRE
+} Motif;
+
+/** Paramètres de la simulation. */
+static Motif motif = REGULIER;
+static unsigned long periode = 1000;
+static unsigned long nombreEntrees = 1000;
+static unsigned char canauxActifs = 2;
+static unsigned long tailleRafale = 8;
+static unsigned long dureeInterruption = 60;
+static unsigned long dureeCommande = 40;
+static unsigned long intervalleLecture = 0;
+
+/** Un microcontrôleur simulé. */
+typedef struct {
+    Registres registres;
+
+    /** Le nœud exécute une interruption jusqu'à cet instant. */
+    unsigned long occupeJusqua;
+
+    /** La boucle principale est occupée jusqu'à cet instant. */
+    unsigned long boucleJusqua;
+
+    /** Instant de fin de la conversion A/D en cours, ou 0. */
+    unsigned long finConversion;
+
+    /** Cycles restants avant le prochain pas des temporisateurs 0 et 2. */
+    unsigned long diviseurTmr0;
+    unsigned long diviseurTmr2;
+    unsigned char tmr0;
+
+    /** Indique que l'esclave a été adressé depuis le dernier START. */
+    unsigned char adresse;
+
+    /** Nombre d'octets de données reçus depuis l'adresse. */
+    unsigned char octetsRecus;
+
+    /** Interruptions de haute priorité que personne ne traite. */
+    unsigned long interruptionsOrphelines;
+
+    /** Cycles passés actif, au repos et en sommeil (voir veille.h). */
+    unsigned long cyclesActifs, cyclesRepos, cyclesSommeil;
+} Noeud;
+
+static Noeud emetteur;
+static Noeud recepteur;
+
+/** Tensions des entrées analogiques de l'émetteur, en valeur générique. */
+static unsigned char analogique[32];
+
+/** Entrées analogiques de chaque canal, comme dans emetteur.c. */
+static const unsigned char entreeAnalogique[SIMULATION_CANAUX] = {9, 13};
+
+/** Instant courant, en cycles. */
+static unsigned long instant;
+
+typedef enum {
+    BUS_LIBRE,
+    BUS_START,          // START ou START répété.
+    BUS_ATTENTE,        // Le maître doit écrire SSP1BUF, RSEN, RCEN, ACKEN ou PEN.
+    BUS_OCTET,
+    BUS_RECEPTION,      // Le maître reçoit un octet de l'esclave.
+    BUS_ACQUITTEMENT,   // Le maître acquitte l'octet reçu.
+    BUS_STOP
+} EtatBus;
+
+/** Le bus I2C partagé. */
+static struct {
+    EtatBus etat;
+    unsigned long fin;
+    unsigned char octet;
+    unsigned char livre;        // L'esclave a reçu l'octet en cours.
+    unsigned char ack;
+    unsigned char start;        // START à signaler à l'esclave.
+    unsigned char stop;         // STOP à signaler à l'esclave.
+    unsigned char esclaveEmet;  // Le maître lit l'esclave.
+    unsigned char pret;         // 1: l'esclave a libéré l'horloge (CKP),
+                                // 2: l'octet est reçu, en attente d'ACK.
+    unsigned char acquittement; // ACK (1) ou NACK (2) à signaler à l'esclave.
+} bus;
+
+/** Une entrée, et ce qu'elle est devenue. */
+typedef struct {
+    unsigned long instant;
+    unsigned char canal;
+    unsigned char valeur;       // Valeur générique.
+    unsigned char attendu;      // Valeur attendue dans CCPRxL.
+} Entree;
+
+static Entree entrees[SIMULATION_ENTREES_MAXIMUM];
+static unsigned long prochaineEntree;
+
+/** Entrées de chaque canal pas encore vues à la sortie. */
+static unsigned long premiereEnAttente[SIMULATION_CANAUX];
+static unsigned char sortie[SIMULATION_CANAUX];
+
+/** Résultats. */
+static unsigned long recues, livrees, perdues, debordements;
+static unsigned long latenceMinimum, latenceMaximum, latenceTotale;
+static unsigned long histogramme[SIMULATION_CLASSES];
+static unsigned long lectures, lecturesErronees;
+
+static void charge(Noeud *noeud) {
+    memcpy((void *) &registres, (void *) &noeud->registres, sizeof(Registres));
+}
+
+static void sauve(Noeud *noeud) {
+    memcpy((void *) &noeud->registres, (void *) &registres, sizeof(Registres));
+}
+
+/**
+ * Remet les registres dans leur état après un RESET: toutes les
+ * interruptions sont de haute priorité.
+ */
+static void reinitialiseRegistres() {
+    memset((void *) &registres, 0, sizeof(Registres));
+    INTCON2bits.TMR0IP = 1;
+    INTCON3bits.INT1IP = 1;
+    INTCON3bits.INT2IP = 1;
+    IPR1bits.TMR2IP = 1;
+    IPR1bits.SSP1IP = 1;
+    IPR1bits.ADIP = 1;
+    IPR1bits.TX1IP = 1;
+    IPR1bits.RC1IP = 1;
+    IPR4bits.CCP4IP = 1;
+    PR2 = 0xFF;
+}
+
+/**
+ * Indique si une interruption de la priorité indiquée est en attente
+ * dans le nœud chargé.
+ */
+static unsigned char interruptionEnAttente(unsigned char haute) {
+    if (INTCON3bits.INT1F && INTCON3bits.INT1E && INTCON3bits.INT1IP == haute) return 255;
+    if (INTCON3bits.INT2F && INTCON3bits.INT2E && INTCON3bits.INT2IP == haute) return 255;
+    if (INTCONbits.TMR0IF && INTCONbits.TMR0IE && INTCON2bits.TMR0IP == haute) return 255;
+    if (PIR1bits.ADIF && PIE1bits.ADIE && IPR1bits.ADIP == haute) return 255;
+    if (PIR1bits.SSP1IF && PIE1bits.SSP1IE && IPR1bits.SSP1IP == haute) return 255;
+    if (PIR1bits.TMR2IF && PIE1bits.TMR2IE && IPR1bits.TMR2IP == haute) return 255;
+    return 0;
+}
+
+/**
+ * Efface les drapeaux d'interruption de la priorité indiquée.
+ */
+static void effaceInterruptions(unsigned char haute) {
+    if (INTCON3bits.INT1IP == haute) INTCON3bits.INT1F = 0;
+    if (INTCON3bits.INT2IP == haute) INTCON3bits.INT2F = 0;
+    if (INTCON2bits.TMR0IP == haute) INTCONbits.TMR0IF = 0;
+    if (IPR1bits.ADIP == haute) PIR1bits.ADIF = 0;
+    if (IPR1bits.SSP1IP == haute) PIR1bits.SSP1IF = 0;
+    if (IPR1bits.TMR2IP == haute) PIR1bits.TMR2IF = 0;
+}
+
+/**
+ * Occupe le nœud pendant la durée d'une interruption, qui retarde
+ * d'autant les interruptions de basse priorité et la boucle principale.
+ */
+static void occupe(Noeud *noeud) {
+    if (noeud->occupeJusqua > instant) {
+        noeud->occupeJusqua += dureeInterruption;
+    } else {
+        noeud->occupeJusqua = instant + dureeInterruption;
+    }
+    if (noeud->boucleJusqua > instant) {
+        noeud->boucleJusqua += dureeInterruption;
+    }
+}
+
+/**
+ * Compte le cycle courant du nœud chargé: actif s'il exécute une 
+ * interruption ou sa boucle principale, sinon en veille, comme 
+ * veilleAttend. Le délai de réveil n'est pas modélisé.
+ * @param sommeilPossible Le nœud peut arrêter son oscillateur.
+ */
+static void compteVeille(Noeud *noeud, unsigned char sommeilPossible) {
+    if (noeud->occupeJusqua > instant || noeud->boucleJusqua > instant) {
+        noeud->cyclesActifs++;
+    } else if (sommeilPossible) {
+        noeud->cyclesSommeil++;
+    } else {
+        noeud->cyclesRepos++;
+    }
+}
+
+/**
+ * Exécute les interruptions en attente du nœud chargé, comme le ferait
+ * main.c. La haute priorité interrompt la basse priorité.
+ */
+static void executeInterruptions(Noeud *noeud, void (*haute)(), void (*basse)()) {
+    if (!INTCONbits.GIEH) {
+        return;
+    }
+    if (interruptionEnAttente(1)) {
+        if (haute) {
+            haute();
+        }
+        // Un drapeau que personne n'efface bloquerait le vrai PIC:
+        if (interruptionEnAttente(1)) {
+            noeud->interruptionsOrphelines++;
+            effaceInterruptions(1);
+        }
+        occupe(noeud);
+    }
+    if (noeud->occupeJusqua <= instant && INTCONbits.GIEL && interruptionEnAttente(0)) {
+        basse();
+        occupe(noeud);
+    }
+}
+
+/**
+ * Fait avancer le convertisseur A/D du nœud chargé.
+ */
+static void avanceConversion(Noeud *noeud) {
+    static const unsigned char tacq[8] = {0, 2, 4, 6, 8, 12, 16, 20};
+    static const unsigned char tad[8] = {2, 8, 32, 2, 4, 16, 64, 2};
+    unsigned int valeur;
+
+    if (!ADCON0bits.GO) {
+        noeud->finConversion = 0;
+        return;
+    }
+    if (noeud->finConversion == 0) {
+        // TAD en périodes d'oscillateur, 4 par cycle d'instruction:
+        noeud->finConversion = instant + 1 +
+                (tacq[ADCON2bits.ACQT] + 11) * tad[ADCON2bits.ADCS] / 4;
+    } else if (instant >= noeud->finConversion) {
+        valeur = analogique[ADCON0bits.CHS] << 2;
+        if (ADCON2bits.ADFM) {
+            ADRESH = valeur >> 8;
+            ADRESL = valeur & 0xFF;
+        } else {
+            ADRESH = valeur >> 2;
+            ADRESL = 0;
+        }
+        ADCON0bits.GO = 0;
+        PIR1bits.ADIF = 1;
+        noeud->finConversion = 0;
+    }
+}
+
+/**
+ * Fait avancer les temporisateurs 0 (8 bits), 2 et 5 (sans diviseur) 
+ * du nœud chargé.
+ */
+static void avanceTemporisateurs(Noeud *noeud) {
+    static const unsigned char diviseurTmr2[4] = {1, 4, 16, 16};
+
+    if (T0CONbits.TMR0ON) {
+        if (noeud->diviseurTmr0 == 0) {
+            noeud->diviseurTmr0 = T0CONbits.PSA ? 1 : 2 << T0CONbits.T0PS;
+        }
+        if (--noeud->diviseurTmr0 == 0) {
+            if (++noeud->tmr0 == 0) {
+                INTCONbits.TMR0IF = 1;
+            }
+        }
+    }
+    if (T2CONbits.TMR2ON) {
+        if (noeud->diviseurTmr2 == 0) {
+            noeud->diviseurTmr2 = diviseurTmr2[T2CONbits.T2CKPS];
+        }
+        if (--noeud->diviseurTmr2 == 0) {
+            if (TMR2 == PR2) {
+                TMR2 = 0;
+                PIR1bits.TMR2IF = 1;
+            } else {
+                TMR2++;
+            }
+        }
+    }
+    if (T5CONbits.TMR5ON) {
+        if (++TMR5L == 0) {
+            TMR5H++;
+        }
+    }
+}
+
+/**
+ * Fait avancer le MSSP maître (l'émetteur est chargé).
+ */
+static void avanceMaitre() {
+    unsigned long bit = SSP1ADD + 1;
+
+    switch (bus.etat) {
+        case BUS_LIBRE:
+            if (SSP1CON2bits.SEN) {
+                bus.etat = BUS_START;
+                bus.fin = instant + bit;
+            }
+            break;
+        case BUS_START:
+            if (instant >= bus.fin) {
+                SSP1CON2bits.SEN = 0;
+                SSP1CON2bits.RSEN = 0;
+                SSP1STATbits.S = 1;
+                SSP1STATbits.P = 0;
+                PIR1bits.SSP1IF = 1;
+                bus.start = 255;
+                bus.etat = BUS_ATTENTE;
+            }
+            break;
+        case BUS_OCTET:
+            if (bus.livre) {
+                SSP1STATbits.BF = 0;
+                SSP1CON2bits.ACKSTAT = bus.ack ? 0 : 1;
+                PIR1bits.SSP1IF = 1;
+                bus.etat = BUS_ATTENTE;
+            }
+            break;
+        case BUS_RECEPTION:
+            // L'horloge ne tourne que quand l'esclave l'a libérée:
+            if (bus.pret != 1) {
+                bus.fin = instant + 8 * bit;
+            } else if (instant >= bus.fin) {
+                SSP1BUF = bus.octet;
+                SSP1STATbits.BF = 1;
+                SSP1CON2bits.RCEN = 0;
+                PIR1bits.SSP1IF = 1;
+                bus.pret = 2;
+                bus.etat = BUS_ATTENTE;
+            }
+            break;
+        case BUS_ACQUITTEMENT:
+            if (instant >= bus.fin) {
+                SSP1CON2bits.ACKEN = 0;
+                PIR1bits.SSP1IF = 1;
+                bus.acquittement = SSP1CON2bits.ACKDT ? 2 : 1;
+                bus.etat = BUS_ATTENTE;
+            }
+            break;
+        case BUS_STOP:
+            if (instant >= bus.fin) {
+                SSP1CON2bits.PEN = 0;
+                SSP1STATbits.S = 0;
+                SSP1STATbits.P = 1;
+                if (SSP1CON3bits.PCIE) {
+                    PIR1bits.SSP1IF = 1;
+                }
+                bus.stop = 255;
+                bus.etat = BUS_LIBRE;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Après l'interruption de l'émetteur: si elle a traité SSP1IF, elle a
+ * soit écrit SSP1BUF, soit demandé un STOP, un START répété, une
+ * réception ou un acquittement.
+ */
+static void maitreApresInterruption() {
+    unsigned long bit = SSP1ADD + 1;
+
+    if (bus.etat != BUS_ATTENTE || PIR1bits.SSP1IF) {
+        return;
+    }
+    if (SSP1CON2bits.PEN) {
+        bus.etat = BUS_STOP;
+        bus.fin = instant + bit;
+    } else if (SSP1CON2bits.RSEN) {
+        bus.etat = BUS_START;
+        bus.fin = instant + 2 * bit;
+    } else if (SSP1CON2bits.RCEN) {
+        SSP1STATbits.BF = 0;
+        bus.etat = BUS_RECEPTION;
+        bus.fin = instant + 8 * bit;
+    } else if (SSP1CON2bits.ACKEN) {
+        SSP1STATbits.BF = 0;
+        bus.etat = BUS_ACQUITTEMENT;
+        bus.fin = instant + bit;
+    } else {
+        bus.etat = BUS_OCTET;
+        bus.octet = SSP1BUF;
+        bus.livre = 0;
+        bus.fin = instant + 9 * bit;
+        SSP1STATbits.BF = 1;
+    }
+}
+
+/**
+ * Fait avancer le MSSP esclave (le récepteur est chargé).
+ */
+static void avanceEsclave(Noeud *noeud) {
+    unsigned char masque = SSP1MSK & 0xFE;
+
+    if (bus.start) {
+        bus.start = 0;
+        SSP1STATbits.S = 1;
+        SSP1STATbits.P = 0;
+        SSP1STATbits.R_NOT_W = 0;
+        noeud->adresse = 0;
+        bus.esclaveEmet = 0;
+        if (SSP1CON3bits.SCIE) {
+            PIR1bits.SSP1IF = 1;
+        }
+    }
+    if (bus.stop) {
+        bus.stop = 0;
+        SSP1STATbits.S = 0;
+        SSP1STATbits.P = 1;
+        if (SSP1CON3bits.PCIE) {
+            PIR1bits.SSP1IF = 1;
+        }
+        SSP1STATbits.R_NOT_W = 0;
+        noeud->adresse = 0;
+        bus.esclaveEmet = 0;
+    }
+    if (bus.acquittement) {
+        // Après un ACK, l'esclave doit fournir l'octet suivant; après un
+        // NACK, la lecture est finie:
+        SSP1STATbits.DA = 1;
+        SSP1STATbits.BF = 0;
+        SSP1CON2bits.ACKSTAT = bus.acquittement == 2;
+        if (bus.acquittement == 1) {
+            SSP1CON1bits.CKP = 0;
+            bus.pret = 0;
+        } else {
+            SSP1STATbits.R_NOT_W = 0;
+            bus.esclaveEmet = 0;
+        }
+        PIR1bits.SSP1IF = 1;
+        bus.acquittement = 0;
+    }
+    if (bus.etat == BUS_OCTET && !bus.livre && instant >= bus.fin) {
+        bus.livre = 255;
+        bus.ack = 0;
+        if (!noeud->adresse) {
+            if ((bus.octet & masque) != (SSP1ADD & masque)
+                    && !(SSP1CON2bits.GCEN && bus.octet == APPEL_GENERAL)) {
+                return;
+            }
+            noeud->adresse = 255;
+            noeud->octetsRecus = 0;
+            SSP1STATbits.DA = 0;
+            SSP1STATbits.R_NOT_W = bus.octet & 1;
+            if (bus.octet & 1) {
+                // Lecture: l'horloge est retenue jusqu'à ce que
+                // l'esclave ait écrit SSP1BUF et remis CKP à 1.
+                SSP1BUF = bus.octet;
+                SSP1STATbits.BF = 1;
+                SSP1CON1bits.CKP = 0;
+                PIR1bits.SSP1IF = 1;
+                bus.esclaveEmet = 255;
+                bus.pret = 0;
+                bus.ack = 255;
+                return;
+            }
+        } else {
+            SSP1STATbits.DA = 1;
+        }
+        if (SSP1STATbits.BF || SSP1CON1bits.SSPOV) {
+            // L'octet précédent n'a pas été lu, ou le débordement
+            // précédent n'a pas été effacé: l'octet est perdu.
+            SSP1CON1bits.SSPOV = 1;
+            debordements++;
+            return;
+        }
+        if (SSP1STATbits.DA && noeud->octetsRecus++) {
+            // Le premier octet est le registre, les suivants des valeurs:
+            recues++;
+        }
+        SSP1BUF = bus.octet;
+        SSP1STATbits.BF = 1;
+        PIR1bits.SSP1IF = 1;
+        bus.ack = 255;
+    }
+}
+
+/**
+ * Demande périodiquement les registres d'état du récepteur, comme le
+ * ferait la boucle principale de l'émetteur, et vérifie le résultat.
+ */
+static void litEtat() {
+    unsigned char etat[I2C_LECTURE_TAILLE];
+    unsigned char nombre;
+
+    if (intervalleLecture && instant % intervalleLecture == 0) {
+        emetteurDemandeEtat();
+    }
+    nombre = i2cLitLecture(etat);
+    if (nombre) {
+        lectures++;
+        if (nombre != I2C_NOMBRE_REGISTRES_ETAT
+                || etat[ETAT_VERSION] != I2C_VERSION
+                || etat[ETAT_CANAUX] != PWM_NOMBRE_DE_CANAUX
+                || etat[ETAT_FILE_MAXIMUM] > FILE_TAILLE
+                || (etat[ETAT_RAFALES_RECUES] | etat[ETAT_RAFALES_RECUES + 1] << 8) > i2cRafalesRecues) {
+            lecturesErronees++;
+        }
+    }
+}
+
+/**
+ * Après l'interruption du récepteur: pendant une lecture, l'esclave
+ * libère l'horloge (CKP) quand il a écrit l'octet suivant dans SSP1BUF.
+ */
+static void esclaveApresInterruption() {
+    if (bus.esclaveEmet && bus.pret == 0 && SSP1CON1bits.CKP && !PIR1bits.SSP1IF) {
+        bus.octet = SSP1BUF;
+        bus.pret = 1;
+    }
+}
+
+/**
+ * Enregistre l'arrivée d'une valeur sur une sortie, et la rapproche de
+ * l'entrée qui l'a produite.
+ */
+static void observeSortie(unsigned char canal, unsigned char valeur) {
+    unsigned long n, latence;
+
+    if (valeur == 0 || valeur == sortie[canal]) {
+        return;
+    }
+    sortie[canal] = valeur;
+    // Cherche l'entrée la plus récente qui produit cette valeur:
+    n = prochaineEntree;
+    do {
+        if (n == premiereEnAttente[canal]) {
+            return;
+        }
+        n--;
+    } while (entrees[n].canal != canal || entrees[n].attendu != valeur);
+    latence = instant - entrees[n].instant;
+    livrees++;
+    latenceTotale += latence;
+    if (latence < latenceMinimum) {
+        latenceMinimum = latence;
+    }
+    if (latence > latenceMaximum) {
+        latenceMaximum = latence;
+    }
+    latence = latence * SIMULATION_NS_PAR_CYCLE / 1000000;
+    histogramme[latence < SIMULATION_CLASSES ? latence : SIMULATION_CLASSES - 1]++;
+    // Les entrées plus anciennes de ce canal ne sortiront jamais:
+    for (; premiereEnAttente[canal] < n; premiereEnAttente[canal]++) {
+        if (entrees[premiereEnAttente[canal]].canal == canal) {
+            perdues++;
+        }
+    }
+    premiereEnAttente[canal] = n + 1;
+}
+
+/**
+ * Prépare les entrées selon le motif choisi. Deux entrées successives
+ * d'un même canal donnent toujours des sorties différentes, pour que
+ * chacune soit visible.
+ */
+static void prepareEntrees() {
+    unsigned long n, t = periode, ecart;
+    unsigned char valeur[SIMULATION_CANAUX] = {0, 0};
+    unsigned char canal, v;
+
+    srand(1);
+    for (n = 0; n < nombreEntrees; n++) {
+        canal = n % canauxActifs;
+        v = valeur[canal];
+        do {
+            v += 37;
+        } while (pwmConversion(v) == pwmConversion(valeur[canal]) || pwmConversion(v) == 0);
+        valeur[canal] = v;
+        entrees[n].instant = t;
+        entrees[n].canal = canal;
+        entrees[n].valeur = v;
+        entrees[n].attendu = pwmConversion(v);
+        switch (motif) {
+            case RAFALE:
+                ecart = ((n + 1) % tailleRafale) ? periode / tailleRafale : periode * tailleRafale;
+                break;
+            case ALEATOIRE:
+                ecart = 1 + (unsigned long) rand() % (2 * periode);
+                break;
+            default:
+                ecart = periode;
+                break;
+        }
+        if (ecart == 0) {
+            ecart = 1;
+        }
+        t += ecart;
+    }
+}
+
+/**
+ * Injecte les entrées dont l'instant est arrivé (l'émetteur est chargé).
+ */
+static void injecteEntrees() {
+    Entree *entree;
+    while (prochaineEntree < nombreEntrees && entrees[prochaineEntree].instant <= instant) {
+        entree = &entrees[prochaineEntree++];
+        analogique[entreeAnalogique[entree->canal]] = entree->valeur;
+#ifndef EMETTEUR_BALAYAGE
+        // Les deux boutons convertissent la même entrée AN9:
+        analogique[9] = entree->valeur;
+        if (entree->canal == 0) {
+            INTCON3bits.INT1F = 1;
+        } else {
+            INTCON3bits.INT2F = 1;
+        }
+#endif
+    }
+}
+
+/**
+ * Exécute une simulation complète avec les paramètres courants.
+ */
+static void simule() {
+    unsigned long fin, n;
+    unsigned char enAttente;
+
+    memset(&bus, 0, sizeof(bus));
+    memset(&emetteur, 0, sizeof(emetteur));
+    memset(&recepteur, 0, sizeof(recepteur));
+    memset(analogique, 0, sizeof(analogique));
+    memset(histogramme, 0, sizeof(histogramme));
+    memset(sortie, 0, sizeof(sortie));
+    memset(premiereEnAttente, 0, sizeof(premiereEnAttente));
+    recues = livrees = perdues = debordements = latenceMaximum = latenceTotale = 0;
+    lectures = lecturesErronees = 0;
+    latenceMinimum = (unsigned long) -1;
+    prochaineEntree = 0;
+    instant = 0;
+
+    prepareEntrees();
+
+    reinitialiseRegistres();
+    emetteurInitialise();
+    sauve(&emetteur);
+    reinitialiseRegistres();
+    // Pas de cavalier: les résistances de tirage donnent le numéro 0.
+    PORTBbits.RB5 = 1;
+    PORTBbits.RB6 = 1;
+    PORTBbits.RB7 = 1;
+    recepteurInitialise();
+    sauve(&recepteur);
+
+    // Laisse le temps aux dernières entrées d'arriver:
+    fin = entrees[nombreEntrees - 1].instant + 25000;
+    for (instant = 1; instant < fin; instant++) {
+        charge(&emetteur);
+        injecteEntrees();
+        avanceConversion(&emetteur);
+        avanceTemporisateurs(&emetteur);
+        avanceMaitre();
+        executeInterruptions(&emetteur, 0, emetteurInterruptions);
+        maitreApresInterruption();
+        litEtat();
+#if defined(EMETTEUR_BALAYAGE) || defined(EMETTEUR_CAPTURE)
+        compteVeille(&emetteur, 0);
+#else
+        compteVeille(&emetteur, bus.etat == BUS_LIBRE && !ADCON0bits.GO);
+#endif
+        sauve(&emetteur);
+
+        charge(&recepteur);
+        avanceTemporisateurs(&recepteur);
+        avanceEsclave(&recepteur);
+        enAttente = SSP1STATbits.BF;
+        executeInterruptions(&recepteur, recepteurInterruptionsHautePriorite, recepteurInterruptions);
+        if (enAttente && !PIR1bits.SSP1IF) {
+            // Le modèle ne voit pas les lectures de SSP1BUF: on suppose
+            // que l'interruption qui a effacé SSP1IF l'a lu.
+            SSP1STATbits.BF = 0;
+        }
+        esclaveApresInterruption();
+        if (recepteur.occupeJusqua <= instant && recepteur.boucleJusqua <= instant && i2cCommandeRecue()) {
+            n = (unsigned char) (fileReception.fileEntree - fileReception.fileSortie) / 2;
+            recepteurBoucle();
+            recepteur.boucleJusqua = instant + n * dureeCommande;
+        }
+        observeSortie(0, CCPR1L);
+        observeSortie(1, CCPR3L);
+        compteVeille(&recepteur, 0);
+        sauve(&recepteur);
+    }
+    // Les entrées encore en attente ne sont pas sorties:
+    for (n = 0; n < SIMULATION_CANAUX; n++) {
+        for (; premiereEnAttente[n] < nombreEntrees; premiereEnAttente[n]++) {
+            if (entrees[premiereEnAttente[n]].canal == n) {
+                perdues++;
+            }
+        }
+    }
+}
+
+/**
+ * Affiche le résultat de la dernière simulation sur une ligne:
+ * période (us), entrées/s, valeurs reçues par le récepteur, valeurs 
+ * sorties sur CCPRxL, valeurs perdues, débordements, interruptions
+ * orphelines, latence min/moyenne/max (us).
+ */
+static void afficheResultat() {
+    double duree = (double) entrees[nombreEntrees - 1].instant * SIMULATION_NS_PAR_CYCLE / 1e9;
+    printf("%8lu %9.1f %7lu %7lu %7lu %6lu %6lu %8lu %8lu %8lu\n",
+            periode * SIMULATION_NS_PAR_CYCLE / 1000,
+            nombreEntrees / duree,
+            recues, livrees, perdues, debordements,
+            emetteur.interruptionsOrphelines + recepteur.interruptionsOrphelines,
+            livrees ? latenceMinimum * SIMULATION_NS_PAR_CYCLE / 1000 : 0,
+            livrees ? latenceTotale / livrees * SIMULATION_NS_PAR_CYCLE / 1000 : 0,
+            latenceMaximum * SIMULATION_NS_PAR_CYCLE / 1000);
+}
+
+static void afficheEntete() {
+    printf("# periode entrees/s  recues sorties perdues debord orphel  lat.min  lat.moy  lat.max (us)\n");
+}
+
+static void afficheHistogramme() {
+    unsigned int n;
+    printf("# latence (ms) nombre\n");
+    for (n = 0; n < SIMULATION_CLASSES; n++) {
+        if (histogramme[n]) {
+            printf("%2u%s %lu\n", n, n == SIMULATION_CLASSES - 1 ? "+" : " ", histogramme[n]);
+        }
+    }
+}
+
+static void afficheVeille(const char *nom, Noeud *noeud) {
+    double total = noeud->cyclesActifs + noeud->cyclesRepos + noeud->cyclesSommeil;
+    printf("veille %s %.1f %.1f %.1f\n", nom,
+            100.0 * noeud->cyclesActifs / total,
+            100.0 * noeud->cyclesRepos / total,
+            100.0 * noeud->cyclesSommeil / total);
+}
+
+static void afficheCompteurs() {
+    printf("# file enfiles rejetes maximum\n");
+    printf("emission %u %u %u\n", fileEmission.enfiles, fileEmission.rejetes, fileEmission.maximum);
+    printf("reception %u %u %u\n", fileReception.enfiles, fileReception.rejetes, fileReception.maximum);
+    printf("# rafales emises recues\n");
+    printf("rafales %u %u\n", i2cRafalesEmises, i2cRafalesRecues);
+    printf("# valeurs remplacees dans la boite aux lettres\n");
+    printf("remplacees %u\n", i2cValeursRemplacees);
+    printf("# lectures d'etat, erronees\n");
+    printf("lectures %lu %lu\n", lectures, lecturesErronees);
+#ifdef RECEPTEUR_MESURE_LATENCE
+    printf("# latence du recepteur (cycles) derniere maximum\n");
+    printf("latence %u %u\n", recepteurLatence, recepteurLatenceMaximum);
+#endif
+    printf("# veille (%% du temps) noeud actif repos sommeil\n");
+    afficheVeille("emetteur", &emetteur);
+    afficheVeille("recepteur", &recepteur);
+}
+
+/**
+ * Réduit la période, et affiche le débit maximum soutenu: toutes les
+ * entrées arrivent au récepteur, sans débordement. Les sorties ne
+ * changent qu'une fois par trame PWM, donc au-delà d'une entrée par
+ * trame et par canal, certaines valeurs reçues ne sortent jamais.
+ */
+static void balaye() {
+    static const unsigned long periodes[] = {
+        25000, 10000, 7500, 5000, 2500, 1500, 1000, 800, 600, 500, 400, 300, 250, 200, 150, 100, 75, 50, 25
+    };
+    unsigned int n;
+    double debitMaximum = 0;
+
+    afficheEntete();
+    for (n = 0; n < sizeof(periodes) / sizeof(periodes[0]); n++) {
+        periode = periodes[n];
+        simule();
+        afficheResultat();
+        if (recues == nombreEntrees && debordements == 0) {
+            debitMaximum = 1e9 / (periode * SIMULATION_NS_PAR_CYCLE);
+        }
+    }
+    printf("# debit maximum soutenu: %.1f commandes/s\n", debitMaximum);
+}
+
+int main(int argc, char **argv) {
+    int n;
+    unsigned char balayage = 0, histogrammeDemande = 0, compteursDemandes = 0;
+
+    for (n = 1; n < argc; n++) {
+        if (argv[n][0] != '-') {
+            continue;
+        }
+        switch (argv[n][1]) {
+            case 'b': balayage = 255; continue;
+            case 'h': histogrammeDemande = 255; continue;
+            case 't': compteursDemandes = 255; continue;
+        }
+        if (n + 1 >= argc) {
+            fprintf(stderr, "Option %s sans valeur\n", argv[n]);
+            return 1;
+        }
+        switch (argv[n][1]) {
+            case 'm':
+                motif = strcmp(argv[n + 1], "rafale") == 0 ? RAFALE :
+                        strcmp(argv[n + 1], "aleatoire") == 0 ? ALEATOIRE : REGULIER;
+                break;
+            case 'p': periode = strtoul(argv[n + 1], NULL, 10); break;
+            case 'n': nombreEntrees = strtoul(argv[n + 1], NULL, 10); break;
+            case 'c': canauxActifs = atoi(argv[n + 1]); break;
+            case 'r': tailleRafale = strtoul(argv[n + 1], NULL, 10); break;
+            case 'i': dureeInterruption = strtoul(argv[n + 1], NULL, 10); break;
+            case 'l': dureeCommande = strtoul(argv[n + 1], NULL, 10); break;
+            case 'e': intervalleLecture = strtoul(argv[n + 1], NULL, 10); break;
+            default:
+                fprintf(stderr, "Option inconnue: %s\n", argv[n]);
+                return 1;
+        }
+        n++;
+    }
+    if (nombreEntrees < 1 || nombreEntrees > SIMULATION_ENTREES_MAXIMUM) {
+        nombreEntrees = SIMULATION_ENTREES_MAXIMUM;
+    }
+    if (canauxActifs < 1 || canauxActifs > SIMULATION_CANAUX) {
+        canauxActifs = SIMULATION_CANAUX;
+    }
+    if (tailleRafale < 1) {
+        tailleRafale = 1;
+    }
+
+    if (balayage) {
+        balaye();
+    } else {
+        afficheEntete();
+        simule();
+        afficheResultat();
+        if (histogrammeDemande) {
+            afficheHistogramme();
+        }
+        if (compteursDemandes) {
+            afficheCompteurs();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,27 @@
+#include "test.h"
+#include "file.h"
+#include "filtre.h"
+#include "i2c.h"
+#include "pwm.h"
+#include "sequenceur.h"
+#include "emetteur.h"
+#include "trace.h"
+
+/**
+ * Exécute les tests du micrologiciel sur l'hôte, dans le même ordre
+ * que le main de test de main.c.
+ * @return Le nombre de tests en erreur, pour que make échoue.
+ */
+int main() {
+    initialiseTests();
+    testFile();
+    testPwm();
+    testSequenceur();
+    testI2c();
+    testEmetteur();
+    testFiltre();
+#ifdef TRACE
+    testTrace();
+#endif
+    return finaliseTests();
+}
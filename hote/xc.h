@@ -0,0 +1,235 @@
+#ifndef XC_H
+#define XC_H
+
+/**
+ * Modèle des registres du PIC18F25K22 pour compiler le micrologiciel
+ * sur l'ordinateur hôte, à la place du xc.h de XC8.
+ * Tous les registres sont rassemblés dans une seule structure, pour
+ * qu'un simulateur puisse sauvegarder et restaurer l'état complet d'un
+ * microcontrôleur par une simple copie.
+ * Seuls les registres et les bits utilisés par le micrologiciel sont
+ * modélisés. Les noms de bits sont ceux de XC8. Pour ajouter un
+ * registre, il faut le déclarer dans la structure, puis le nommer
+ * plus bas.
+ */
+
+/** Les mots-clés de XC8 qui n'ont pas de sens sur l'hôte. */
+#define interrupt
+#define low_priority
+#define high_priority
+#define SLEEP()
+#define NOP()
+#define CLRWDT()
+
+typedef struct {
+    // Registres d'un octet:
+    volatile unsigned char SSP1BUF;
+    volatile unsigned char SSP1ADD;
+    volatile unsigned char SSP1MSK;
+    volatile unsigned char ADRESH;
+    volatile unsigned char ADRESL;
+    volatile unsigned char CCPR1L;
+    volatile unsigned char CCPR2L;
+    volatile unsigned char CCPR2H;
+    volatile unsigned char CCPR3L;
+    volatile unsigned char CCPR4L;
+    volatile unsigned char CCPR4H;
+    volatile unsigned char CCPR5L;
+    volatile unsigned char CCPR5H;
+    volatile unsigned char PR2;
+    volatile unsigned char TMR2;
+    volatile unsigned char TMR1L;
+    volatile unsigned char TMR1H;
+    volatile unsigned char TMR3L;
+    volatile unsigned char TMR3H;
+    volatile unsigned char TMR5L;
+    volatile unsigned char TMR5H;
+    volatile unsigned char TXREG1;
+    volatile unsigned char RCREG1;
+    volatile unsigned char SPBRG;
+    volatile unsigned char SPBRGH;
+    volatile unsigned char LATA;
+    volatile unsigned char LATB;
+    volatile unsigned char LATC;
+    volatile unsigned char TRISA;
+    volatile unsigned char TRISB;
+    volatile unsigned char TRISC;
+    volatile unsigned char ANSELA;
+    volatile unsigned char ANSELB;
+    volatile unsigned char ANSELC;
+    volatile unsigned char PORTB;
+
+    // Registres accessibles bit à bit:
+    volatile struct {
+        unsigned GIEH:1; unsigned GIEL:1; unsigned TMR0IF:1; unsigned TMR0IE:1;
+    } INTCONbits;
+    volatile struct {
+        unsigned RBPU:1; unsigned INTEDG1:1; unsigned INTEDG2:1; unsigned TMR0IP:1;
+    } INTCON2bits;
+    volatile struct {
+        unsigned INT1F:1; unsigned INT2F:1; unsigned INT1E:1; unsigned INT2E:1;
+        unsigned INT1IP:1; unsigned INT2IP:1;
+    } INTCON3bits;
+    volatile struct {
+        unsigned TMR2IF:1; unsigned SSP1IF:1; unsigned ADIF:1;
+        unsigned TX1IF:1; unsigned RC1IF:1;
+    } PIR1bits;
+    volatile struct {
+        unsigned TMR2IE:1; unsigned SSP1IE:1; unsigned ADIE:1;
+        unsigned TX1IE:1; unsigned RC1IE:1;
+    } PIE1bits;
+    volatile struct {
+        unsigned TMR2IP:1; unsigned SSP1IP:1; unsigned ADIP:1;
+        unsigned TX1IP:1; unsigned RC1IP:1;
+    } IPR1bits;
+    volatile struct { unsigned CCP2IF:1; } PIR2bits;
+    volatile struct { unsigned CCP2IE:1; } PIE2bits;
+    volatile struct { unsigned CCP2IP:1; } IPR2bits;
+    volatile struct { unsigned CCP3IF:1; unsigned CCP4IF:1; unsigned CCP5IF:1; } PIR4bits;
+    volatile struct { unsigned CCP3IE:1; unsigned CCP4IE:1; unsigned CCP5IE:1; } PIE4bits;
+    volatile struct { unsigned CCP3IP:1; unsigned CCP4IP:1; unsigned CCP5IP:1; } IPR4bits;
+    volatile struct { unsigned IPEN:1; } RCONbits;
+    volatile struct { unsigned IDLEN:1; unsigned IRCF:3; unsigned HFIOFS:1; } OSCCONbits;
+    volatile struct { unsigned PLLEN:1; } OSCTUNEbits;
+    volatile struct { unsigned GO:1; unsigned ADON:1; unsigned CHS:5; } ADCON0bits;
+    volatile struct { unsigned ADFM:1; unsigned ACQT:3; unsigned ADCS:3; } ADCON2bits;
+    volatile struct {
+        unsigned SSPEN:1; unsigned SSPM:4; unsigned CKP:1;
+        unsigned WCOL:1; unsigned SSPOV:1;
+    } SSP1CON1bits;
+    volatile struct {
+        unsigned SEN:1; unsigned PEN:1; unsigned RSEN:1; unsigned RCEN:1;
+        unsigned ACKEN:1; unsigned ACKDT:1; unsigned ACKSTAT:1; unsigned GCEN:1;
+    } SSP1CON2bits;
+    volatile struct {
+        unsigned PCIE:1; unsigned SCIE:1; unsigned SBCDE:1; unsigned BOEN:1;
+        unsigned AHEN:1; unsigned DHEN:1;
+    } SSP1CON3bits;
+    volatile struct {
+        unsigned P:1; unsigned S:1; unsigned BF:1; unsigned DA:1;
+        unsigned R_NOT_W:1; unsigned D_NOT_A:1; unsigned SMP:1;
+    } SSP1STATbits;
+    volatile struct { unsigned T08BIT:1; unsigned T0CS:1; unsigned PSA:1; unsigned T0PS:3; unsigned TMR0ON:1; } T0CONbits;
+    volatile struct { unsigned TMR1CS:2; unsigned T1CKPS:2; unsigned T1RD16:1; unsigned TMR1ON:1; } T1CONbits;
+    volatile struct { unsigned T2CKPS:2; unsigned T2OUTPS:4; unsigned TMR2ON:1; } T2CONbits;
+    volatile struct { unsigned TMR3CS:2; unsigned T3CKPS:2; unsigned T3RD16:1; unsigned TMR3ON:1; } T3CONbits;
+    volatile struct { unsigned TMR5CS:2; unsigned T5CKPS:2; unsigned T5RD16:1; unsigned TMR5ON:1; } T5CONbits;
+    volatile struct { unsigned P1M:2; unsigned CCP1M:4; unsigned DC1B:2; } CCP1CONbits;
+    volatile struct { unsigned CCP2M:4; } CCP2CONbits;
+    volatile struct { unsigned P3M:2; unsigned CCP3M:4; unsigned DC3B:2; } CCP3CONbits;
+    volatile struct { unsigned CCP4M:4; } CCP4CONbits;
+    volatile struct { unsigned CCP5M:4; } CCP5CONbits;
+    volatile struct { unsigned C1TSEL:2; unsigned C2TSEL:2; unsigned C3TSEL:2; } CCPTMRS0bits;
+    volatile struct { unsigned C4TSEL:2; unsigned C5TSEL:2; } CCPTMRS1bits;
+    volatile struct { unsigned SPEN:1; unsigned CREN:1; unsigned OERR:1; } RCSTAbits;
+    volatile struct { unsigned SYNC:1; unsigned TXEN:1; unsigned BRGH:1; unsigned TRMT:1; } TXSTAbits;
+    volatile struct { unsigned BRG16:1; } BAUDCONbits;
+    volatile struct { unsigned RA0:1; unsigned RA4:1; } TRISAbits;
+    volatile struct {
+        unsigned RB0:1; unsigned RB1:1; unsigned RB2:1; unsigned RB3:1;
+        unsigned RB4:1; unsigned RB5:1; unsigned RB6:1; unsigned RB7:1;
+    } TRISBbits;
+    volatile struct {
+        unsigned RC0:1; unsigned RC1:1; unsigned RC2:1; unsigned RC3:1;
+        unsigned RC4:1; unsigned RC5:1; unsigned RC6:1; unsigned RC7:1;
+    } TRISCbits;
+    volatile struct { unsigned ANSA0:1; unsigned ANSA4:1; } ANSELAbits;
+    volatile struct {
+        unsigned ANSB0:1; unsigned ANSB1:1; unsigned ANSB2:1; unsigned ANSB3:1;
+        unsigned ANSB4:1; unsigned ANSB5:1;
+    } ANSELBbits;
+    volatile struct { unsigned ANSC2:1; unsigned ANSC3:1; unsigned ANSC4:1; unsigned ANSC6:1; unsigned ANSC7:1; } ANSELCbits;
+    volatile struct {
+        unsigned WPUB1:1; unsigned WPUB2:1; unsigned WPUB5:1; unsigned WPUB6:1;
+        unsigned WPUB7:1;
+    } WPUBbits;
+    volatile struct {
+        unsigned RB4:1; unsigned RB5:1; unsigned RB6:1; unsigned RB7:1;
+    } PORTBbits;
+} Registres;
+
+/** Les registres du microcontrôleur simulé. */
+extern Registres registres;
+
+#define SSP1BUF registres.SSP1BUF
+#define SSP1ADD registres.SSP1ADD
+#define SSP1MSK registres.SSP1MSK
+#define ADRESH registres.ADRESH
+#define ADRESL registres.ADRESL
+#define CCPR1L registres.CCPR1L
+#define CCPR2L registres.CCPR2L
+#define CCPR2H registres.CCPR2H
+#define CCPR3L registres.CCPR3L
+#define CCPR4L registres.CCPR4L
+#define CCPR4H registres.CCPR4H
+#define CCPR5L registres.CCPR5L
+#define CCPR5H registres.CCPR5H
+#define PR2 registres.PR2
+#define TMR2 registres.TMR2
+#define TMR1L registres.TMR1L
+#define TMR1H registres.TMR1H
+#define TMR3L registres.TMR3L
+#define TMR3H registres.TMR3H
+#define TMR5L registres.TMR5L
+#define TMR5H registres.TMR5H
+#define TXREG1 registres.TXREG1
+#define RCREG1 registres.RCREG1
+#define SPBRG registres.SPBRG
+#define SPBRGH registres.SPBRGH
+#define LATA registres.LATA
+#define LATB registres.LATB
+#define LATC registres.LATC
+#define TRISA registres.TRISA
+#define TRISB registres.TRISB
+#define TRISC registres.TRISC
+#define ANSELA registres.ANSELA
+#define ANSELB registres.ANSELB
+#define ANSELC registres.ANSELC
+#define PORTB registres.PORTB
+
+#define INTCONbits registres.INTCONbits
+#define INTCON2bits registres.INTCON2bits
+#define INTCON3bits registres.INTCON3bits
+#define PIR1bits registres.PIR1bits
+#define PIE1bits registres.PIE1bits
+#define IPR1bits registres.IPR1bits
+#define PIR2bits registres.PIR2bits
+#define PIE2bits registres.PIE2bits
+#define IPR2bits registres.IPR2bits
+#define PIR4bits registres.PIR4bits
+#define PIE4bits registres.PIE4bits
+#define IPR4bits registres.IPR4bits
+#define RCONbits registres.RCONbits
+#define OSCCONbits registres.OSCCONbits
+#define OSCTUNEbits registres.OSCTUNEbits
+#define ADCON0bits registres.ADCON0bits
+#define ADCON2bits registres.ADCON2bits
+#define SSP1CON1bits registres.SSP1CON1bits
+#define SSP1CON2bits registres.SSP1CON2bits
+#define SSP1CON3bits registres.SSP1CON3bits
+#define SSP1STATbits registres.SSP1STATbits
+#define T0CONbits registres.T0CONbits
+#define T1CONbits registres.T1CONbits
+#define T2CONbits registres.T2CONbits
+#define T3CONbits registres.T3CONbits
+#define T5CONbits registres.T5CONbits
+#define CCP1CONbits registres.CCP1CONbits
+#define CCP2CONbits registres.CCP2CONbits
+#define CCP3CONbits registres.CCP3CONbits
+#define CCP4CONbits registres.CCP4CONbits
+#define CCP5CONbits registres.CCP5CONbits
+#define CCPTMRS0bits registres.CCPTMRS0bits
+#define CCPTMRS1bits registres.CCPTMRS1bits
+#define RCSTAbits registres.RCSTAbits
+#define TXSTAbits registres.TXSTAbits
+#define BAUDCONbits registres.BAUDCONbits
+#define TRISAbits registres.TRISAbits
+#define TRISBbits registres.TRISBbits
+#define TRISCbits registres.TRISCbits
+#define ANSELAbits registres.ANSELAbits
+#define ANSELBbits registres.ANSELBbits
+#define ANSELCbits registres.ANSELCbits
+#define WPUBbits registres.WPUBbits
+#define PORTBbits registres.PORTBbits
+
+#endif
@@ -1,29 +1,167 @@
 #include <xc.h>
 #include "i2c.h"
 #include "file.h"
+#include "pwm.h"
 #include "test.h"
 
-#define I2C_LONGEUR_COMMANDE 3
-
 /**
  * États possibles de la commande en cours.
+ * Une commande est une rafale: l'adresse, le premier registre, puis
+ * une ou plusieurs valeurs destinées aux registres consécutifs.
+ * Une lecture est l'adresse, le premier registre, un START répété,
+ * l'adresse en lecture, puis les octets reçus de l'esclave.
+ * Quand une commande est terminée et que la file n'est pas vide, la 
+ * suivante commence par un START répété, même si elle s'adresse à un
+ * autre esclave; le STOP n'est émis que quand la file est vide.
  */
 typedef enum {
     ADRESSE,
     COMMANDE,
     VALEUR,
+    REDEMARRAGE,
+    ADRESSE_LECTURE,
+    LECTURE,
+    ACQUITTEMENT,
     COMMANDE_TERMINEE
 } EtatTransmissionCommande;
 
 /** État de la commande en cours. */
 EtatTransmissionCommande etatTransmissionCommande = COMMANDE_TERMINEE;
 
+/** Nombre de valeurs qu'il reste à émettre dans la rafale en cours. */
+static unsigned char valeursRestantes = 0;
+
+unsigned int i2cRafalesEmises;
+unsigned int i2cRafalesRecues;
+unsigned int i2cValeursRemplacees;
+
+/** Adresse de la lecture en cours (bit R/W à 1), ou 0 pour une rafale. */
+static unsigned char adresseLecture = 0;
+
+/** Octets reçus par la lecture en cours. */
+static unsigned char lecture[I2C_LECTURE_TAILLE];
+static unsigned char octetsLus = 0;
+
+/** Nombre d'octets de la dernière lecture terminée, ou 0. */
+static volatile unsigned char lectureTerminee = 0;
+
+/** Indique qu'une lecture est dans la file ou en cours. */
+static volatile unsigned char lectureEnAttente = 0;
+
+/**
+ * Contient les rafales à émettre, sous la forme:
+ * adresse, nombre de valeurs, premier registre, valeurs...
+ * Le nombre de valeurs n'est pas émis sur le bus.
+ */
 File fileEmission;
 
 /**
+ * Boîte aux lettres des servos: une seule valeur en attente par canal.
+ * Une nouvelle valeur remplace celle qui n'a pas encore été émise.
+ */
+static unsigned char boiteValeur[I2C_NOMBRE_DE_CANAUX];
+
+/** Les 2 bits de poids faible des valeurs de 10 bits de la boîte. */
+static unsigned char boitePrecision[I2C_NOMBRE_DE_CANAUX];
+
+/** Un bit par canal dont la valeur n'a pas encore été émise. */
+static unsigned char boiteEnAttente = 0;
+
+/** Un bit par canal en attente dont la précision n'est pas nulle. */
+static unsigned char boitePrecise = 0;
+
+/** Adresse de l'esclave qui reçoit les valeurs de la boîte. */
+static Adresse boiteAdresse;
+
+/**
+ * Transfère les valeurs en attente de la boîte aux lettres vers
+ * la file d'émission, en une seule rafale qui va du premier au dernier
+ * canal en attente. Si l'une d'elles a des bits de précision, la 
+ * rafale utilise les registres PRECIS1.
+ */
+static void i2cVideBoiteAuxLettres() {
+    unsigned char premier = 0;
+    unsigned char dernier = I2C_NOMBRE_DE_CANAUX - 1;
+    unsigned char valeurs[I2C_TAILLE_PRECIS * I2C_NOMBRE_DE_CANAUX];
+    unsigned char n, canal;
+
+    while (!(boiteEnAttente & (1 << premier))) {
+        premier++;
+    }
+    while (!(boiteEnAttente & (1 << dernier))) {
+        dernier--;
+    }
+    if (boitePrecise) {
+        n = 0;
+        for (canal = premier; canal <= dernier; canal++) {
+            valeurs[n++] = boiteValeur[canal];
+            valeurs[n++] = boitePrecision[canal];
+        }
+        i2cPrepareRafalePourEmission(boiteAdresse, PRECIS1 + I2C_TAILLE_PRECIS * premier, valeurs, n);
+    } else {
+        i2cPrepareRafalePourEmission(boiteAdresse, SERVO1 + premier, &boiteValeur[premier], dernier - premier + 1);
+    }
+    boiteEnAttente = 0;
+    boitePrecise = 0;
+}
+
+/**
+ * Dépose la valeur de 10 bits d'un servo dans la boîte aux lettres. Si
+ * une valeur était déjà en attente pour ce canal, elle est remplacée: 
+ * c'est toujours la valeur la plus récente qui est émise. La boîte ne 
+ * sert qu'un esclave à la fois: si l'adresse change, les valeurs en 
+ * attente pour l'esclave précédent partent d'abord dans la file 
+ * d'émission.
+ * @param adresse Adresse de l'esclave.
+ * @param type Le servo (SERVO1, SERVO2...).
+ * @param valeur La valeur, entre 0 et 1023.
+ */
+void i2cDeposeValeurServoPrecise(Adresse adresse, CommandeType type, unsigned int valeur) {
+    unsigned char canal = type - SERVO1;
+    unsigned char masque;
+    if (canal < I2C_NOMBRE_DE_CANAUX) {
+        if (boiteEnAttente && (adresse != boiteAdresse)) {
+            i2cVideBoiteAuxLettres();
+        }
+        masque = 1 << canal;
+        if (boiteEnAttente & masque) {
+            i2cValeursRemplacees++;
+        }
+        boiteAdresse = adresse;
+        boiteValeur[canal] = valeur >> 2;
+        boitePrecision[canal] = valeur & 3;
+        if (valeur & 3) {
+            boitePrecise |= masque;
+        } else {
+            boitePrecise &= ~masque;
+        }
+        boiteEnAttente |= masque;
+    }
+}
+
+/**
+ * Dépose la valeur de 8 bits d'un servo dans la boîte aux lettres
+ * (voir i2cDeposeValeurServoPrecise).
+ * @param adresse Adresse de l'esclave.
+ * @param type Le servo (SERVO1, SERVO2...).
+ * @param valeur La valeur.
+ */
+void i2cDeposeValeurServo(Adresse adresse, CommandeType type, unsigned char valeur) {
+    i2cDeposeValeurServoPrecise(adresse, type, (unsigned int) valeur << 2);
+}
+
+/**
+ * Indique si il reste des données à émettre. Si la commande précédente
+ * est terminée et que la file est vide, récupère les valeurs en attente
+ * dans la boîte aux lettres.
  * @return 255 / -1 si il reste des données à émettre.
  */
 unsigned char i2cDonneesDisponiblesPourEmission() {
+    if (boiteEnAttente 
+            && fileEstVide(&fileEmission) 
+            && etatTransmissionCommande == COMMANDE_TERMINEE) {
+        i2cVideBoiteAuxLettres();
+    }
     if (fileEstVide(&fileEmission)) {
         return 0;
     } else {
@@ -41,16 +179,36 @@ unsigned char i2cDonneesDisponiblesPourEmission() {
  * @return 
  */
 unsigned char i2cRecupereCaracterePourEmission() {
+    unsigned char c;
     switch(etatTransmissionCommande) {
         case ADRESSE:
             etatTransmissionCommande = COMMANDE;
-            return fileDefile(&fileEmission);
+            c = fileDefile(&fileEmission);
+            valeursRestantes = fileDefile(&fileEmission);
+            if (c & 1) {
+                // Une lecture commence par écrire le premier registre:
+                adresseLecture = c;
+                octetsLus = 0;
+                return c & 0xFE;
+            }
+            adresseLecture = 0;
+            return c;
         case COMMANDE:
-            etatTransmissionCommande = VALEUR;
+            if (adresseLecture) {
+                etatTransmissionCommande = REDEMARRAGE;
+            } else {
+                etatTransmissionCommande = VALEUR;
+            }
             return fileDefile(&fileEmission);
         case VALEUR:
-            etatTransmissionCommande = COMMANDE_TERMINEE;
+            if (--valeursRestantes == 0) {
+                etatTransmissionCommande = COMMANDE_TERMINEE;
+                i2cRafalesEmises++;
+            }
             return fileDefile(&fileEmission);
+        case ADRESSE_LECTURE:
+            etatTransmissionCommande = LECTURE;
+            return adresseLecture;
         default:
             return 0;
     }
@@ -68,42 +226,219 @@ unsigned char i2cCommandeCompletementEmise() {
     }
 }
 
+/**
+ * Prépare l'émission d'une rafale: le récepteur range la première valeur
+ * dans le registre <code>premier</code>, et les suivantes dans les 
+ * registres consécutifs.
+ * Si la file n'a pas la place pour toute la rafale, ou si le nombre de
+ * valeurs est hors limites, celle-ci est ignorée.
+ * @param adresse Adresse de l'esclave.
+ * @param premier Premier registre (type de commande).
+ * @param valeurs Les valeurs.
+ * @param nombre Nombre de valeurs, entre 1 et FILE_TAILLE - 3.
+ */
+void i2cPrepareRafalePourEmission(Adresse adresse, CommandeType premier, unsigned char *valeurs, unsigned char nombre) {
+    // Une rafale vide ferait boucler le compte des valeurs restantes:
+    if ((nombre == 0) || (nombre > FILE_TAILLE - 3)
+            || (fileEspaceDisponible(&fileEmission) < nombre + 3)) {
+        // Au-delà de 252 valeurs, nombre + 3 déborderait d'un octet:
+        fileRejette(&fileEmission, (nombre > 255 - 3) ? 255 : nombre + 3);
+        return;
+    }
+    fileEnfile(&fileEmission, adresse);
+    fileEnfile(&fileEmission, nombre);
+    fileEnfile(&fileEmission, premier);
+    while (nombre--) {
+        fileEnfile(&fileEmission, *valeurs++);
+    }
+}
+
+/**
+ * Prépare la lecture de registres consécutifs de l'esclave. Le résultat
+ * est disponible avec i2cLitLecture quand la lecture est terminée.
+ * Si une lecture est déjà en attente, ou si la file n'a pas la place,
+ * la lecture est ignorée: les lectures ne peuvent donc pas retarder
+ * les valeurs des servos de plus d'une lecture. Elle est aussi ignorée
+ * si le nombre d'octets est hors limites.
+ * @param adresse Adresse de l'esclave.
+ * @param registre Premier registre à lire.
+ * @param nombre Nombre d'octets, entre 1 et I2C_LECTURE_TAILLE.
+ */
+void i2cPrepareLecture(Adresse adresse, unsigned char registre, unsigned char nombre) {
+    if (lectureEnAttente) {
+        return;
+    }
+    // Une lecture vide ferait boucler le compte des octets restants, et
+    // une lecture trop longue perdrait les octets en trop:
+    if ((nombre == 0) || (nombre > I2C_LECTURE_TAILLE)
+            || (fileEspaceDisponible(&fileEmission) < 3)) {
+        fileRejette(&fileEmission, 3);
+        return;
+    }
+    fileEnfile(&fileEmission, adresse | 1);
+    fileEnfile(&fileEmission, nombre);
+    fileEnfile(&fileEmission, registre);
+    lectureEnAttente = 255;
+}
+
+/**
+ * Indique au maître la prochaine opération, après chaque interruption
+ * du MSSP qui n'est pas un STOP. Le START répété et la réception sont
+ * considérés comme faits dès qu'ils sont rendus.
+ * À la fin d'une commande, si d'autres données attendent, le maître
+ * enchaîne avec un START répété au lieu de STOP puis START.
+ * @return L'opération à effectuer.
+ */
+OperationMaitre i2cOperationMaitre() {
+    switch(etatTransmissionCommande) {
+        case REDEMARRAGE:
+            etatTransmissionCommande = ADRESSE_LECTURE;
+            return I2C_REDEMARRE;
+        case LECTURE:
+            etatTransmissionCommande = ACQUITTEMENT;
+            return I2C_RECOIT;
+        case ACQUITTEMENT:
+            return I2C_ACQUITTE;
+        case COMMANDE_TERMINEE:
+            if (i2cDonneesDisponiblesPourEmission()) {
+                return I2C_REDEMARRE;
+            }
+            return I2C_ARRETE;
+        default:
+            return I2C_EMET;
+    }
+}
+
+/**
+ * Range un octet reçu par le maître pendant une lecture.
+ * @param octet L'octet reçu.
+ * @return 255 si d'autres octets sont attendus (le maître acquitte),
+ * 0 si c'était le dernier (le maître n'acquitte pas).
+ */
+unsigned char i2cReceptionLecture(unsigned char octet) {
+    if (octetsLus < I2C_LECTURE_TAILLE) {
+        lecture[octetsLus++] = octet;
+    }
+    if (--valeursRestantes == 0) {
+        etatTransmissionCommande = COMMANDE_TERMINEE;
+        lectureTerminee = octetsLus;
+        lectureEnAttente = 0;
+        return 0;
+    }
+    etatTransmissionCommande = LECTURE;
+    return 255;
+}
+
+/**
+ * Rend le résultat de la dernière lecture terminée, une seule fois.
+ * @param valeurs Reçoit les octets lus (I2C_LECTURE_TAILLE au plus).
+ * @return Le nombre d'octets lus, ou 0 si aucune lecture n'est terminée.
+ */
+unsigned char i2cLitLecture(unsigned char *valeurs) {
+    unsigned char n, nombre = lectureTerminee;
+    for (n = 0; n < nombre; n++) {
+        valeurs[n] = lecture[n];
+    }
+    lectureTerminee = 0;
+    return nombre;
+}
+
 /**
  * Prépare l'émission de la commande indiquée.
  * @param type Type de commande. 
  * @param valeur Valeur associée.
  */
 void i2cPrepareCommandePourEmission(Adresse adresse, CommandeType type, unsigned char valeur) {
-    fileEnfile(&fileEmission, adresse);
-    if (etatTransmissionCommande == COMMANDE_TERMINEE) {
-        etatTransmissionCommande = ADRESSE;
-    }
-    fileEnfile(&fileEmission, type);
-    fileEnfile(&fileEmission, valeur);
+    i2cPrepareRafalePourEmission(adresse, type, &valeur, 1);
 }
 
 Commande commandeEnCoursDeReception;
 
+/** Indique si le registre de la rafale en cours a déjà été reçu. */
+static unsigned char registreRecu;
+
+/**
+ * Indique si la rafale en cours a apporté au moins une valeur. Le 
+ * maître qui lit les registres d'état n'écrit que le registre: ces 
+ * rafales ne comptent pas dans i2cRafalesRecues.
+ */
+static unsigned char valeurRecue;
+
+/** Prochain registre lu par le maître. */
+static unsigned char registreLecture;
+
+/**
+ * Reçoit l'adresse, au début d'une rafale. Après un START répété,
+ * il n'y a pas eu de STOP: la rafale précédente est terminée ici.
+ * @param adresse L'adresse reçue.
+ */
 void i2cReceptionAdresse(Adresse adresse) {
+    i2cFinDeReception();
     commandeEnCoursDeReception.adresse = adresse;
     commandeEnCoursDeReception.commande = 0;
     commandeEnCoursDeReception.valeur = 0;
+    registreRecu = 0;
+    valeurRecue = 0;
 }
 
+File fileReception;
+
+/**
+ * Reçoit un octet de données.
+ * Le premier octet d'une rafale est le registre; chaque octet suivant
+ * est une valeur, qui est enfilée avec son registre. Le registre est
+ * ensuite incrémenté pour la valeur suivante.
+ * @param donnee L'octet reçu.
+ */
 void i2cReceptionDonnee(unsigned char donnee) {
-    commandeEnCoursDeReception.commande = commandeEnCoursDeReception.valeur;
-    commandeEnCoursDeReception.valeur = donnee;    
+    if (!registreRecu) {
+        commandeEnCoursDeReception.commande = donnee;
+        registreLecture = donnee;
+        registreRecu = 255;
+    } else {
+        commandeEnCoursDeReception.valeur = donnee;
+        valeurRecue = 255;
+        if (fileEspaceDisponible(&fileReception) >= 2) {
+            fileEnfile(&fileReception, commandeEnCoursDeReception.commande);
+            fileEnfile(&fileReception, donnee);
+        } else {
+            fileRejette(&fileReception, 2);
+        }
+        commandeEnCoursDeReception.commande++;
+    }
 }
 
-File fileReception;
+/**
+ * Position de la file de réception à la fin de la dernière rafale
+ * terminée. Les commandes au-delà appartiennent à une rafale en cours,
+ * et ne sont pas encore rendues par i2cCommandeRecue. Modifiée 
+ * seulement par l'interruption, et lue en un seul octet.
+ */
+static volatile unsigned char finDeRafale;
 
+/**
+ * Termine la rafale en cours.
+ * Les valeurs sont déjà dans la file de réception; elles deviennent 
+ * disponibles toutes ensemble.
+ */
 void i2cFinDeReception() {
-    fileEnfile(&fileReception, commandeEnCoursDeReception.commande);
-    fileEnfile(&fileReception, commandeEnCoursDeReception.valeur);
+    if (valeurRecue) {
+        i2cRafalesRecues++;
+    }
+    registreRecu = 0;
+    valeurRecue = 0;
+    finDeRafale = fileReception.fileEntree;
 }
 
+/**
+ * Indique si une commande d'une rafale terminée attend d'être lue.
+ * Les commandes d'une rafale en cours de réception attendent sa fin:
+ * une rafale n'est jamais appliquée en deux fois. Elle doit donc tenir
+ * dans la file de réception (FILE_TAILLE / 2 valeurs).
+ * @return 1 si une commande est disponible, 0 autrement.
+ */
 unsigned char i2cCommandeRecue() {
-    if (fileEstVide(&fileReception)) {
+    if (fileReception.fileSortie == finDeRafale) {
         return 0;
     } else {
         return 1;
@@ -115,6 +450,25 @@ void i2cLitCommandeRecue(Commande *commande) {
     commande->valeur = fileDefile(&fileReception);
 }
 
+/**
+ * Rend le registre que le maître lit, et passe au suivant.
+ * Le premier est celui de la dernière rafale reçue.
+ * @return Le registre.
+ */
+unsigned char i2cRegistrePourLecture() {
+    return registreLecture++;
+}
+
+/**
+ * Rend l'adresse du récepteur indiqué.
+ * @param numero Le numéro du récepteur, entre 0 et 
+ * I2C_NOMBRE_DE_MODULES - 1. Les bits en trop sont ignorés.
+ * @return L'adresse, avec le bit R/W à 0.
+ */
+Adresse i2cAdresseModule(unsigned char numero) {
+    return MODULE_SERVO + ((numero & (I2C_NOMBRE_DE_MODULES - 1)) << 1);
+}
+
 /**
  * Réinitialise la machine i2c.
  */
@@ -122,6 +476,20 @@ void i2cReinitialise() {
     fileReinitialise(&fileEmission);
     fileReinitialise(&fileReception);
     etatTransmissionCommande = COMMANDE_TERMINEE;
+    valeursRestantes = 0;
+    boiteEnAttente = 0;
+    boitePrecise = 0;
+    registreRecu = 0;
+    valeurRecue = 0;
+    finDeRafale = 0;
+    i2cRafalesEmises = 0;
+    i2cValeursRemplacees = 0;
+    i2cRafalesRecues = 0;
+    adresseLecture = 0;
+    octetsLus = 0;
+    lectureTerminee = 0;
+    lectureEnAttente = 0;
+    registreLecture = 0;
 }
 
 #ifdef TEST
@@ -167,8 +535,509 @@ void testEmissionDeuxCommandes() {
     testeEgaliteEntiers("I2CEA16", i2cDonneesDisponiblesPourEmission(), 0);
 }
 
+void testEmissionRafale() {
+    unsigned char valeurs[] = {10, 20, 30};
+    i2cReinitialise();
+    i2cPrepareRafalePourEmission(MODULE_SERVO, SERVO1, valeurs, 3);
+
+    testeEgaliteEntiers("I2CER01", i2cDonneesDisponiblesPourEmission(), 255);
+    testeEgaliteEntiers("I2CER02", i2cRecupereCaracterePourEmission(), MODULE_SERVO);
+    testeEgaliteEntiers("I2CER03", i2cCommandeCompletementEmise(), 0);
+    testeEgaliteEntiers("I2CER04", i2cRecupereCaracterePourEmission(), SERVO1);
+    testeEgaliteEntiers("I2CER05", i2cCommandeCompletementEmise(), 0);
+    testeEgaliteEntiers("I2CER06", i2cRecupereCaracterePourEmission(), 10);
+    testeEgaliteEntiers("I2CER07", i2cCommandeCompletementEmise(), 0);
+    testeEgaliteEntiers("I2CER08", i2cRecupereCaracterePourEmission(), 20);
+    testeEgaliteEntiers("I2CER09", i2cCommandeCompletementEmise(), 0);
+    testeEgaliteEntiers("I2CER10", i2cRecupereCaracterePourEmission(), 30);
+    testeEgaliteEntiers("I2CER11", i2cCommandeCompletementEmise(), 255);
+    testeEgaliteEntiers("I2CER12", i2cDonneesDisponiblesPourEmission(), 0);
+}
+
+void testEmissionRafaleTropLongue() {
+    unsigned char valeurs[FILE_TAILLE];
+    i2cReinitialise();
+    i2cPrepareRafalePourEmission(MODULE_SERVO, SERVO1, valeurs, FILE_TAILLE - 2);
+    testeEgaliteEntiers("I2CET01", i2cDonneesDisponiblesPourEmission(), 0);
+    
+    i2cPrepareRafalePourEmission(MODULE_SERVO, SERVO1, valeurs, FILE_TAILLE - 3);
+    testeEgaliteEntiers("I2CET02", i2cDonneesDisponiblesPourEmission(), 255);
+}
+void testEmissionRafaleHorsLimites() {
+    unsigned char valeurs[FILE_TAILLE];
+    i2cReinitialise();
+
+    // Une rafale vide est rejetée:
+    i2cPrepareRafalePourEmission(MODULE_SERVO, SERVO1, valeurs, 0);
+    testeEgaliteEntiers("I2CEH01", i2cDonneesDisponiblesPourEmission(), 0);
+    testeEgaliteEntiers("I2CEH02", fileEmission.rejetes, 3);
+
+    // Même si la file est vide, une rafale trop longue est rejetée:
+    i2cPrepareRafalePourEmission(MODULE_SERVO, SERVO1, valeurs, 255);
+    testeEgaliteEntiers("I2CEH03", i2cDonneesDisponiblesPourEmission(), 0);
+
+    // La commande suivante n'est pas affectée:
+    i2cPrepareCommandePourEmission(MODULE_SERVO, SERVO1, 10);
+    testeEgaliteEntiers("I2CEH04", i2cDonneesDisponiblesPourEmission(), 255);
+    testeEgaliteEntiers("I2CEH05", i2cRecupereCaracterePourEmission(), MODULE_SERVO);
+    testeEgaliteEntiers("I2CEH06", i2cRecupereCaracterePourEmission(), SERVO1);
+    testeEgaliteEntiers("I2CEH07", i2cRecupereCaracterePourEmission(), 10);
+    testeEgaliteEntiers("I2CEH08", i2cCommandeCompletementEmise(), 255);
+
+    // La rafale trop longue compte au moins autant que ses valeurs:
+    testeEgaliteEntiers("I2CEH09", fileEmission.rejetes, 3 + 255);
+}
+
+void testReceptionRafale() {
+    Commande commande;
+    i2cReinitialise();
+    
+    i2cReceptionAdresse(MODULE_SERVO);
+    i2cReceptionDonnee(SERVO1);
+    i2cReceptionDonnee(10);
+    i2cReceptionDonnee(20);
+    i2cFinDeReception();
+
+    testeEgaliteEntiers("I2CR01", i2cCommandeRecue(), 1);
+    i2cLitCommandeRecue(&commande);
+    testeEgaliteEntiers("I2CR02", commande.commande, SERVO1);
+    testeEgaliteEntiers("I2CR03", commande.valeur, 10);
+    testeEgaliteEntiers("I2CR04", i2cCommandeRecue(), 1);
+    i2cLitCommandeRecue(&commande);
+    testeEgaliteEntiers("I2CR05", commande.commande, SERVO2);
+    testeEgaliteEntiers("I2CR06", commande.valeur, 20);
+    testeEgaliteEntiers("I2CR07", i2cCommandeRecue(), 0);
+
+    // Une commande simple est une rafale d'une seule valeur:
+    i2cReceptionAdresse(MODULE_SERVO);
+    i2cReceptionDonnee(SERVO2);
+    i2cReceptionDonnee(30);
+    i2cFinDeReception();
+
+    i2cLitCommandeRecue(&commande);
+    testeEgaliteEntiers("I2CR08", commande.commande, SERVO2);
+    testeEgaliteEntiers("I2CR09", commande.valeur, 30);
+    testeEgaliteEntiers("I2CR10", i2cCommandeRecue(), 0);
+}
+
+/**
+ * Vide complètement la commande en cours, et rend sa première valeur.
+ */
+unsigned char emetCommandeEtRendPremiereValeur() {
+    unsigned char valeur;
+    i2cRecupereCaracterePourEmission();
+    i2cRecupereCaracterePourEmission();
+    valeur = i2cRecupereCaracterePourEmission();
+    while (!i2cCommandeCompletementEmise()) {
+        i2cRecupereCaracterePourEmission();
+    }
+    return valeur;
+}
+
+void testBoiteAuxLettres() {
+    i2cReinitialise();
+    testeEgaliteEntiers("I2CB01", i2cDonneesDisponiblesPourEmission(), 0);
+
+    i2cDeposeValeurServo(MODULE_SERVO, SERVO1, 10);
+    i2cDeposeValeurServo(MODULE_SERVO, SERVO1, 20);
+    i2cDeposeValeurServo(MODULE_SERVO, SERVO2, 5);
+    i2cDeposeValeurServo(MODULE_SERVO, SERVO1, 30);
+
+    // Les deux canaux partent dans la même rafale, avec les dernières valeurs:
+    testeEgaliteEntiers("I2CB02", i2cDonneesDisponiblesPourEmission(), 255);
+    testeEgaliteEntiers("I2CB03", i2cRecupereCaracterePourEmission(), MODULE_SERVO);
+    testeEgaliteEntiers("I2CB04", i2cRecupereCaracterePourEmission(), SERVO1);
+    testeEgaliteEntiers("I2CB05", i2cRecupereCaracterePourEmission(), 30);
+    testeEgaliteEntiers("I2CB06", i2cRecupereCaracterePourEmission(), 5);
+    testeEgaliteEntiers("I2CB07", i2cCommandeCompletementEmise(), 255);
+    testeEgaliteEntiers("I2CB08", i2cDonneesDisponiblesPourEmission(), 0);
+
+    // Une valeur déposée pendant l'émission attend la fin de la commande:
+    i2cDeposeValeurServo(MODULE_SERVO, SERVO2, 40);
+    testeEgaliteEntiers("I2CB09", i2cDonneesDisponiblesPourEmission(), 255);
+    testeEgaliteEntiers("I2CB10", i2cRecupereCaracterePourEmission(), MODULE_SERVO);
+    i2cDeposeValeurServo(MODULE_SERVO, SERVO2, 50);
+    testeEgaliteEntiers("I2CB11", i2cRecupereCaracterePourEmission(), SERVO2);
+    testeEgaliteEntiers("I2CB12", i2cRecupereCaracterePourEmission(), 40);
+    testeEgaliteEntiers("I2CB13", i2cDonneesDisponiblesPourEmission(), 255);
+    testeEgaliteEntiers("I2CB14", emetCommandeEtRendPremiereValeur(), 50);
+    testeEgaliteEntiers("I2CB15", i2cDonneesDisponiblesPourEmission(), 0);
+
+    // 10 et 20 ont été remplacées; 40 était partie avant 50:
+    testeEgaliteEntiers("I2CB16", i2cValeursRemplacees, 2);
+}
+
+void testBoiteAuxLettresAdresses() {
+    Adresse autre = i2cAdresseModule(1);
+    i2cReinitialise();
+
+    // Chaque valeur part vers l'esclave pour lequel elle a été déposée:
+    i2cDeposeValeurServo(MODULE_SERVO, SERVO1, 10);
+    i2cDeposeValeurServo(autre, SERVO2, 20);
+    testeEgaliteEntiers("I2CBA01", i2cDonneesDisponiblesPourEmission(), 255);
+    testeEgaliteEntiers("I2CBA02", i2cRecupereCaracterePourEmission(), MODULE_SERVO);
+    testeEgaliteEntiers("I2CBA03", i2cRecupereCaracterePourEmission(), SERVO1);
+    testeEgaliteEntiers("I2CBA04", i2cRecupereCaracterePourEmission(), 10);
+    testeEgaliteEntiers("I2CBA05", i2cCommandeCompletementEmise(), 255);
+    testeEgaliteEntiers("I2CBA06", i2cDonneesDisponiblesPourEmission(), 255);
+    testeEgaliteEntiers("I2CBA07", i2cRecupereCaracterePourEmission(), autre);
+    testeEgaliteEntiers("I2CBA08", i2cRecupereCaracterePourEmission(), SERVO2);
+    testeEgaliteEntiers("I2CBA09", i2cRecupereCaracterePourEmission(), 20);
+    testeEgaliteEntiers("I2CBA10", i2cCommandeCompletementEmise(), 255);
+    testeEgaliteEntiers("I2CBA11", i2cDonneesDisponiblesPourEmission(), 0);
+
+    // Le même esclave garde la boîte: la valeur est remplacée.
+    i2cDeposeValeurServo(autre, SERVO1, 30);
+    i2cDeposeValeurServo(autre, SERVO1, 40);
+    testeEgaliteEntiers("I2CBA12", i2cDonneesDisponiblesPourEmission(), 255);
+    testeEgaliteEntiers("I2CBA13", emetCommandeEtRendPremiereValeur(), 40);
+    testeEgaliteEntiers("I2CBA14", i2cDonneesDisponiblesPourEmission(), 0);
+}
+
+void testBoiteAuxLettresPrecise() {
+    i2cReinitialise();
+
+    // Une valeur de 10 bits utilise les registres PRECIS1:
+    i2cDeposeValeurServo(MODULE_SERVO, SERVO1, 10);
+    i2cDeposeValeurServoPrecise(MODULE_SERVO, SERVO2, (20 << 2) | 3);
+    testeEgaliteEntiers("I2CBP01", i2cDonneesDisponiblesPourEmission(), 255);
+    testeEgaliteEntiers("I2CBP02", i2cRecupereCaracterePourEmission(), MODULE_SERVO);
+    testeEgaliteEntiers("I2CBP03", i2cRecupereCaracterePourEmission(), PRECIS1);
+    testeEgaliteEntiers("I2CBP04", i2cRecupereCaracterePourEmission(), 10);
+    testeEgaliteEntiers("I2CBP05", i2cRecupereCaracterePourEmission(), 0);
+    testeEgaliteEntiers("I2CBP06", i2cRecupereCaracterePourEmission(), 20);
+    testeEgaliteEntiers("I2CBP07", i2cRecupereCaracterePourEmission(), 3);
+    testeEgaliteEntiers("I2CBP08", i2cCommandeCompletementEmise(), 255);
+
+    // Sans bits de précision, les registres SERVO1 suffisent:
+    i2cDeposeValeurServoPrecise(MODULE_SERVO, SERVO2, (20 << 2) | 3);
+    i2cDeposeValeurServoPrecise(MODULE_SERVO, SERVO2, 30 << 2);
+    testeEgaliteEntiers("I2CBP09", i2cDonneesDisponiblesPourEmission(), 255);
+    testeEgaliteEntiers("I2CBP10", i2cRecupereCaracterePourEmission(), MODULE_SERVO);
+    testeEgaliteEntiers("I2CBP11", i2cRecupereCaracterePourEmission(), SERVO2);
+    testeEgaliteEntiers("I2CBP12", i2cRecupereCaracterePourEmission(), 30);
+    testeEgaliteEntiers("I2CBP13", i2cCommandeCompletementEmise(), 255);
+    testeEgaliteEntiers("I2CBP14", i2cDonneesDisponiblesPourEmission(), 0);
+}
+
+/**
+ * Simule des rafales de mesures qui arrivent plus vite que le bus
+ * ne peut les émettre, et vérifie que la valeur émise est toujours
+ * la plus récente: le retard d'une valeur émise ne dépasse jamais une 
+ * commande, quelle que soit la longueur de la rafale.
+ */
+void testBoiteAuxLettresFraicheur() {
+    unsigned char n, m;
+    unsigned char derniere = 0;
+    
+    i2cReinitialise();
+    for (n = 1; n < 20; n++) {
+        // Une rafale de n mesures pendant une seule commande:
+        for (m = 0; m < n; m++) {
+            i2cDeposeValeurServo(MODULE_SERVO, SERVO1, ++derniere);
+        }
+        if (testeEgaliteEntiers("I2CBF01", i2cDonneesDisponiblesPourEmission(), 255)) {
+            return;
+        }
+        if (testeEgaliteEntiers("I2CBF02", emetCommandeEtRendPremiereValeur(), derniere)) {
+            return;
+        }
+    }
+    testeEgaliteEntiers("I2CBF03", i2cDonneesDisponiblesPourEmission(), 0);
+}
+
+void testCompteursI2c() {
+    unsigned char valeurs[FILE_TAILLE];
+    unsigned char n;
+    i2cReinitialise();
+
+    // Une rafale émise, une rafale trop longue rejetée:
+    i2cPrepareCommandePourEmission(MODULE_SERVO, SERVO1, 10);
+    i2cPrepareRafalePourEmission(MODULE_SERVO, SERVO1, valeurs, FILE_TAILLE - 2);
+    i2cDonneesDisponiblesPourEmission();
+    emetCommandeEtRendPremiereValeur();
+    testeEgaliteEntiers("I2CC01", i2cRafalesEmises, 1);
+    testeEgaliteEntiers("I2CC02", fileEmission.enfiles, 4);
+    testeEgaliteEntiers("I2CC03", fileEmission.rejetes, FILE_TAILLE + 1);
+    testeEgaliteEntiers("I2CC04", fileEmission.maximum, 4);
+
+    // Des rafales reçues jusqu'à remplir la file de réception:
+    for (n = 0; n < FILE_TAILLE / 2 + 1; n++) {
+        i2cReceptionAdresse(MODULE_SERVO);
+        i2cReceptionDonnee(SERVO1);
+        i2cReceptionDonnee(n);
+        i2cFinDeReception();
+    }
+    // Un STOP sans registre n'est pas une rafale:
+    i2cReceptionAdresse(MODULE_SERVO);
+    i2cFinDeReception();
+
+    testeEgaliteEntiers("I2CC05", i2cRafalesRecues, FILE_TAILLE / 2 + 1);
+    testeEgaliteEntiers("I2CC06", fileReception.enfiles, FILE_TAILLE);
+    testeEgaliteEntiers("I2CC07", fileReception.rejetes, 2);
+    testeEgaliteEntiers("I2CC08", fileReception.maximum, FILE_TAILLE);
+}
+
+void testLectureMaitre() {
+    unsigned char valeurs[I2C_LECTURE_TAILLE];
+    i2cReinitialise();
+    i2cPrepareLecture(MODULE_SERVO, ETAT_FILE_OCCUPATION, 2);
+    // Une seule lecture à la fois:
+    i2cPrepareLecture(MODULE_SERVO, ETAT_VERSION, 1);
+
+    testeEgaliteEntiers("I2CL01", i2cDonneesDisponiblesPourEmission(), 255);
+    testeEgaliteEntiers("I2CL02", i2cOperationMaitre(), I2C_EMET);
+    testeEgaliteEntiers("I2CL03", i2cRecupereCaracterePourEmission(), MODULE_SERVO);
+    testeEgaliteEntiers("I2CL04", i2cOperationMaitre(), I2C_EMET);
+    testeEgaliteEntiers("I2CL05", i2cRecupereCaracterePourEmission(), ETAT_FILE_OCCUPATION);
+    testeEgaliteEntiers("I2CL06", i2cOperationMaitre(), I2C_REDEMARRE);
+    testeEgaliteEntiers("I2CL07", i2cOperationMaitre(), I2C_EMET);
+    testeEgaliteEntiers("I2CL08", i2cRecupereCaracterePourEmission(), MODULE_SERVO | 1);
+    testeEgaliteEntiers("I2CL09", i2cOperationMaitre(), I2C_RECOIT);
+    testeEgaliteEntiers("I2CL10", i2cOperationMaitre(), I2C_ACQUITTE);
+    testeEgaliteEntiers("I2CL11", i2cReceptionLecture(10), 255);
+    testeEgaliteEntiers("I2CL12", i2cLitLecture(valeurs), 0);
+    testeEgaliteEntiers("I2CL13", i2cOperationMaitre(), I2C_RECOIT);
+    testeEgaliteEntiers("I2CL14", i2cOperationMaitre(), I2C_ACQUITTE);
+    testeEgaliteEntiers("I2CL15", i2cReceptionLecture(20), 0);
+    testeEgaliteEntiers("I2CL16", i2cOperationMaitre(), I2C_ARRETE);
+    testeEgaliteEntiers("I2CL17", i2cCommandeCompletementEmise(), 255);
+    testeEgaliteEntiers("I2CL18", i2cDonneesDisponiblesPourEmission(), 0);
+
+    testeEgaliteEntiers("I2CL19", i2cLitLecture(valeurs), 2);
+    testeEgaliteEntiers("I2CL20", valeurs[0], 10);
+    testeEgaliteEntiers("I2CL21", valeurs[1], 20);
+    testeEgaliteEntiers("I2CL22", i2cLitLecture(valeurs), 0);
+
+    // Une rafale après la lecture n'est pas affectée:
+    i2cPrepareCommandePourEmission(MODULE_SERVO, SERVO1, 30);
+    testeEgaliteEntiers("I2CL23", i2cDonneesDisponiblesPourEmission(), 255);
+    testeEgaliteEntiers("I2CL24", i2cRecupereCaracterePourEmission(), MODULE_SERVO);
+    testeEgaliteEntiers("I2CL25", i2cRecupereCaracterePourEmission(), SERVO1);
+    testeEgaliteEntiers("I2CL26", i2cOperationMaitre(), I2C_EMET);
+    testeEgaliteEntiers("I2CL27", i2cRecupereCaracterePourEmission(), 30);
+    testeEgaliteEntiers("I2CL28", i2cOperationMaitre(), I2C_ARRETE);
+    testeEgaliteEntiers("I2CL29", i2cDonneesDisponiblesPourEmission(), 0);
+}
+
+void testLectureHorsLimites() {
+    unsigned char valeurs[I2C_LECTURE_TAILLE];
+    i2cReinitialise();
+
+    // Une lecture vide est rejetée:
+    i2cPrepareLecture(MODULE_SERVO, ETAT_VERSION, 0);
+    testeEgaliteEntiers("I2CLH01", i2cDonneesDisponiblesPourEmission(), 0);
+    testeEgaliteEntiers("I2CLH02", fileEmission.rejetes, 3);
+
+    // Une lecture plus longue que le tampon est rejetée:
+    i2cPrepareLecture(MODULE_SERVO, ETAT_VERSION, I2C_LECTURE_TAILLE + 1);
+    testeEgaliteEntiers("I2CLH03", i2cDonneesDisponiblesPourEmission(), 0);
+    testeEgaliteEntiers("I2CLH04", fileEmission.rejetes, 6);
+
+    // Aucune n'est restée en attente: la lecture suivante est acceptée.
+    i2cPrepareLecture(MODULE_SERVO, ETAT_VERSION, 1);
+    testeEgaliteEntiers("I2CLH05", i2cDonneesDisponiblesPourEmission(), 255);
+    testeEgaliteEntiers("I2CLH06", i2cRecupereCaracterePourEmission(), MODULE_SERVO);
+    testeEgaliteEntiers("I2CLH07", i2cRecupereCaracterePourEmission(), ETAT_VERSION);
+    testeEgaliteEntiers("I2CLH08", i2cOperationMaitre(), I2C_REDEMARRE);
+    testeEgaliteEntiers("I2CLH09", i2cOperationMaitre(), I2C_EMET);
+    testeEgaliteEntiers("I2CLH10", i2cRecupereCaracterePourEmission(), MODULE_SERVO | 1);
+    testeEgaliteEntiers("I2CLH11", i2cOperationMaitre(), I2C_RECOIT);
+    testeEgaliteEntiers("I2CLH12", i2cOperationMaitre(), I2C_ACQUITTE);
+    testeEgaliteEntiers("I2CLH13", i2cReceptionLecture(I2C_VERSION), 0);
+    testeEgaliteEntiers("I2CLH14", i2cOperationMaitre(), I2C_ARRETE);
+    testeEgaliteEntiers("I2CLH15", i2cLitLecture(valeurs), 1);
+    testeEgaliteEntiers("I2CLH16", valeurs[0], I2C_VERSION);
+}
+
+void testLectureEsclave() {
+    i2cReinitialise();
+
+    // Le maître écrit le premier registre, sans valeur:
+    i2cReceptionAdresse(MODULE_SERVO);
+    i2cReceptionDonnee(ETAT_FILE_REJETES);
+    testeEgaliteEntiers("I2CLE01", i2cRegistrePourLecture(), ETAT_FILE_REJETES);
+    testeEgaliteEntiers("I2CLE02", i2cRegistrePourLecture(), ETAT_FILE_REJETES + 1);
+    i2cFinDeReception();
+    testeEgaliteEntiers("I2CLE03", i2cCommandeRecue(), 0);
+
+    // Après une rafale, la lecture commence à son premier registre:
+    i2cReceptionAdresse(MODULE_SERVO);
+    i2cReceptionDonnee(SERVO1);
+    i2cReceptionDonnee(10);
+    i2cReceptionDonnee(20);
+    i2cFinDeReception();
+    testeEgaliteEntiers("I2CLE04", i2cRegistrePourLecture(), SERVO1);
+}
+
+void testEnchainement() {
+    unsigned char valeurs[I2C_LECTURE_TAILLE];
+    i2cReinitialise();
+    i2cPrepareCommandePourEmission(MODULE_SERVO, SERVO1, 10);
+    i2cPrepareCommandePourEmission(i2cAdresseModule(1), SERVO2, 20);
+    i2cPrepareLecture(MODULE_SERVO, ETAT_VERSION, 1);
+
+    // Chaque commande suivante commence par un START répété:
+    testeEgaliteEntiers("I2CEN01", i2cDonneesDisponiblesPourEmission(), 255);
+    testeEgaliteEntiers("I2CEN02", i2cRecupereCaracterePourEmission(), MODULE_SERVO);
+    testeEgaliteEntiers("I2CEN03", i2cRecupereCaracterePourEmission(), SERVO1);
+    testeEgaliteEntiers("I2CEN04", i2cRecupereCaracterePourEmission(), 10);
+    testeEgaliteEntiers("I2CEN05", i2cOperationMaitre(), I2C_REDEMARRE);
+    testeEgaliteEntiers("I2CEN06", i2cOperationMaitre(), I2C_EMET);
+    testeEgaliteEntiers("I2CEN07", i2cRecupereCaracterePourEmission(), MODULE_SERVO + 2);
+    testeEgaliteEntiers("I2CEN08", i2cRecupereCaracterePourEmission(), SERVO2);
+    testeEgaliteEntiers("I2CEN09", i2cRecupereCaracterePourEmission(), 20);
+    testeEgaliteEntiers("I2CEN10", i2cOperationMaitre(), I2C_REDEMARRE);
+    testeEgaliteEntiers("I2CEN11", i2cRecupereCaracterePourEmission(), MODULE_SERVO);
+    testeEgaliteEntiers("I2CEN12", i2cRecupereCaracterePourEmission(), ETAT_VERSION);
+    testeEgaliteEntiers("I2CEN13", i2cOperationMaitre(), I2C_REDEMARRE);
+    testeEgaliteEntiers("I2CEN14", i2cRecupereCaracterePourEmission(), MODULE_SERVO | 1);
+    testeEgaliteEntiers("I2CEN15", i2cOperationMaitre(), I2C_RECOIT);
+    testeEgaliteEntiers("I2CEN16", i2cOperationMaitre(), I2C_ACQUITTE);
+
+    // Une valeur déposée pendant la lecture part dans la même transaction:
+    i2cDeposeValeurServo(MODULE_SERVO, SERVO1, 30);
+    testeEgaliteEntiers("I2CEN17", i2cReceptionLecture(I2C_VERSION), 0);
+    testeEgaliteEntiers("I2CEN18", i2cOperationMaitre(), I2C_REDEMARRE);
+    testeEgaliteEntiers("I2CEN19", i2cRecupereCaracterePourEmission(), MODULE_SERVO);
+    testeEgaliteEntiers("I2CEN20", i2cRecupereCaracterePourEmission(), SERVO1);
+    testeEgaliteEntiers("I2CEN21", i2cRecupereCaracterePourEmission(), 30);
+
+    // Le STOP seulement quand la file est vide:
+    testeEgaliteEntiers("I2CEN22", i2cOperationMaitre(), I2C_ARRETE);
+    testeEgaliteEntiers("I2CEN23", i2cRafalesEmises, 3);
+    testeEgaliteEntiers("I2CEN24", i2cLitLecture(valeurs), 1);
+}
+
+/**
+ * Imite une itération de la boucle principale du récepteur: applique
+ * les commandes reçues, et les publie.
+ * @return Le nombre de commandes appliquées.
+ */
+static unsigned char i2cBoucleRecepteur() {
+    Commande commande;
+    unsigned char n = 0;
+
+    while (i2cCommandeRecue()) {
+        i2cLitCommandeRecue(&commande);
+        pwmPrepareValeur(commande.commande - SERVO1);
+        pwmEtablitValeur(commande.valeur);
+        n++;
+    }
+    if (n) {
+        pwmPublie();
+    }
+    return n;
+}
+
+void testReceptionRafaleEntrelacee() {
+    i2cReinitialise();
+    pwmReinitialise();
+
+    // La boucle principale tourne entre chaque octet de la rafale, et
+    // une trame commence entre les deux valeurs:
+    i2cReceptionAdresse(MODULE_SERVO);
+    testeEgaliteEntiers("I2CRE01", i2cBoucleRecepteur(), 0);
+    i2cReceptionDonnee(SERVO1);
+    testeEgaliteEntiers("I2CRE02", i2cBoucleRecepteur(), 0);
+    i2cReceptionDonnee(10);
+    testeEgaliteEntiers("I2CRE03", i2cBoucleRecepteur(), 0);
+    while (!pwmEspacement());
+    testeEgaliteEntiers("I2CRE04", pwmValeurPubliee(0), 0);
+    i2cReceptionDonnee(20);
+    testeEgaliteEntiers("I2CRE05", i2cBoucleRecepteur(), 0);
+
+    // La rafale est appliquée en entier à sa fin, sur une seule trame:
+    i2cFinDeReception();
+    testeEgaliteEntiers("I2CRE06", i2cBoucleRecepteur(), 2);
+    while (!pwmEspacement());
+    testeEgaliteEntiers("I2CRE07", pwmValeurPubliee(0), pwmValeur(0));
+    testeEgaliteEntiers("I2CRE08", pwmValeurPubliee(1), pwmValeur(1));
+    testeEgaliteEntiers("I2CRE09", pwmValeur(1) != 0, 1);
+
+    // Un START répété termine aussi la rafale:
+    i2cReceptionAdresse(MODULE_SERVO);
+    i2cReceptionDonnee(SERVO1);
+    i2cReceptionDonnee(30);
+    testeEgaliteEntiers("I2CRE10", i2cBoucleRecepteur(), 0);
+    i2cReceptionAdresse(MODULE_SERVO);
+    testeEgaliteEntiers("I2CRE11", i2cBoucleRecepteur(), 1);
+
+    pwmReinitialise();
+}
+
+void testReceptionRedemarrage() {
+    Commande commande;
+    i2cReinitialise();
+
+    // Deux rafales séparées par un START répété, sans STOP:
+    i2cReceptionAdresse(MODULE_SERVO);
+    i2cReceptionDonnee(SERVO1);
+    i2cReceptionDonnee(10);
+    i2cReceptionAdresse(MODULE_SERVO);
+    testeEgaliteEntiers("I2CRR01", i2cRafalesRecues, 1);
+    i2cReceptionDonnee(SERVO2);
+    i2cReceptionDonnee(20);
+    i2cFinDeReception();
+    testeEgaliteEntiers("I2CRR02", i2cRafalesRecues, 2);
+
+    // Le registre d'une lecture, sans valeur, n'est pas une rafale:
+    i2cReceptionAdresse(MODULE_SERVO);
+    i2cReceptionDonnee(ETAT_VERSION);
+    i2cReceptionAdresse(MODULE_SERVO | 1);
+    i2cFinDeReception();
+    testeEgaliteEntiers("I2CRR07", i2cRafalesRecues, 2);
+
+    i2cLitCommandeRecue(&commande);
+    testeEgaliteEntiers("I2CRR03", commande.commande, SERVO1);
+    testeEgaliteEntiers("I2CRR04", commande.valeur, 10);
+    i2cLitCommandeRecue(&commande);
+    testeEgaliteEntiers("I2CRR05", commande.commande, SERVO2);
+    testeEgaliteEntiers("I2CRR06", commande.valeur, 20);
+}
+
+void testAdresseModule() {
+    testeEgaliteEntiers("I2CAM01", i2cAdresseModule(0), MODULE_SERVO);
+    testeEgaliteEntiers("I2CAM02", i2cAdresseModule(1), MODULE_SERVO + 2);
+    testeEgaliteEntiers("I2CAM03", i2cAdresseModule(7), MODULE_SERVO + 14);
+    testeEgaliteEntiers("I2CAM04", i2cAdresseModule(8), MODULE_SERVO);
+}
+
+void testReceptionAppelGeneral() {
+    Commande commande;
+    i2cReinitialise();
+
+    i2cReceptionAdresse(APPEL_GENERAL);
+    i2cReceptionDonnee(SERVO1);
+    i2cReceptionDonnee(10);
+    i2cFinDeReception();
+
+    testeEgaliteEntiers("I2CAG01", i2cCommandeRecue(), 1);
+    i2cLitCommandeRecue(&commande);
+    testeEgaliteEntiers("I2CAG02", commande.commande, SERVO1);
+    testeEgaliteEntiers("I2CAG03", commande.valeur, 10);
+    testeEgaliteEntiers("I2CAG04", i2cRafalesRecues, 1);
+}
+
 void testI2c() {
     testEmissionUneCommande();
     testEmissionDeuxCommandes();
+    testEmissionRafale();
+    testEmissionRafaleTropLongue();
+    testEmissionRafaleHorsLimites();
+    testReceptionRafale();
+    testBoiteAuxLettres();
+    testBoiteAuxLettresAdresses();
+    testBoiteAuxLettresPrecise();
+    testBoiteAuxLettresFraicheur();
+    testCompteursI2c();
+    testLectureMaitre();
+    testLectureHorsLimites();
+    testLectureEsclave();
+    testAdresseModule();
+    testReceptionAppelGeneral();
+    testEnchainement();
+    testReceptionRedemarrage();
+    testReceptionRafaleEntrelacee();
 }
 #endif
\ No newline at end of file
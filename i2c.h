@@ -1,25 +1,134 @@
 #ifndef I2C__H
 #define I2C__H
 
+#include "file.h"
+
+/** Nombre de canaux servo de la boîte aux lettres, à partir de SERVO1. */
+#define I2C_NOMBRE_DE_CANAUX 2
+
+/**
+ * Registres du récepteur. Le canal n est à SERVO1 + n, et sa vitesse 
+ * (voir pwmEtablitVitesse) à VITESSE1 + n. Avec une vitesse, le 
+ * récepteur interpole lui-même entre les valeurs reçues, et le maître
+ * peut se contenter des positions clé du mouvement.
+ * La calibration du canal n (voir Calibration dans pwm.h) occupe
+ * I2C_TAILLE_CALIBRATION registres à partir de CALIBRATION1 + 4 * n: 
+ * minimum, maximum, centre et inverse. Une seule rafale les écrit tous.
+ * Elle se relit aux mêmes registres.
+ * Une valeur de 10 bits (voir pwmEtablitValeurPrecise) occupe 
+ * I2C_TAILLE_PRECIS registres à partir de PRECIS1 + 2 * n: les 8 bits
+ * de poids fort, comme SERVO1 + n, puis les 2 bits de poids faible, 
+ * dont l'écriture applique la valeur. Elle se relit aux mêmes registres.
+ * TRAME choisit la fréquence de trame de tous les canaux (voir 
+ * FrequenceTrame dans pwm.h) par sa durée en ms: 20, 10, 5, 4 ou 3. Elle
+ * change au début de la trame suivante, et se relit au même registre.
+ */
 typedef enum {
+    TRAME = 48,
     SERVO1 = 64,
-    SERVO2 = 65
+    SERVO2 = 65,
+    VITESSE1 = 80,
+    VITESSE2 = 81,
+    CALIBRATION1 = 96,
+    CALIBRATION2 = 100,
+    PRECIS1 = 112,
+    PRECIS2 = 114
 } CommandeType;
 
+/** Nombre de registres de la calibration d'un canal. */
+#define I2C_TAILLE_CALIBRATION 4
+
+/** Nombre de registres de la valeur de 10 bits d'un canal. */
+#define I2C_TAILLE_PRECIS 2
+
+/**
+ * Adresses I2C, avec le bit R/W à 0. Chaque récepteur a l'adresse
+ * MODULE_SERVO + 2 * numéro (voir i2cAdresseModule), où le numéro est
+ * lu sur ses cavaliers au démarrage. Tous les récepteurs acceptent 
+ * aussi l'appel général, en écriture seulement: une seule rafale met
+ * à jour tous les récepteurs en même temps.
+ */
 typedef enum {
+    APPEL_GENERAL = 0x00,
     MODULE_SERVO = 0b00001100
 } Adresse;
 
+/** Nombre de récepteurs adressables (3 cavaliers). */
+#define I2C_NOMBRE_DE_MODULES 8
+
+/**
+ * Registres d'état du récepteur, en lecture seulement. Le maître écrit
+ * le premier registre (une rafale sans valeurs), puis lit après un
+ * START répété; le registre est incrémenté après chaque octet lu.
+ * Les compteurs de 16 bits sont lus octet faible d'abord. 
+ * Les registres SERVO1 + n rendent la dernière valeur reçue 
+ * pour le canal n.
+ */
+typedef enum {
+    ETAT_VERSION = 0x00,            // Version du protocole (I2C_VERSION).
+    ETAT_CANAUX = 0x01,             // Nombre de canaux PWM.
+    ETAT_FILE_OCCUPATION = 0x02,    // Octets dans la file de réception.
+    ETAT_FILE_MAXIMUM = 0x03,       // Occupation maximum de la file.
+    ETAT_FILE_REJETES = 0x04,       // Octets rejetés (16 bits).
+    ETAT_RAFALES_RECUES = 0x06,     // Rafales reçues (16 bits).
+    ETAT_DEBORDEMENTS = 0x08,       // Octets perdus par le MSSP (SSPOV).
+    ETAT_COLLISIONS = 0x09          // Écritures refusées de SSP1BUF (WCOL).
+} RegistreEtat;
+
+/** Nombre de registres d'état, à partir de ETAT_VERSION. */
+#define I2C_NOMBRE_REGISTRES_ETAT 16
+
+/** Version du protocole, rendue par ETAT_VERSION. */
+#define I2C_VERSION 5
+
+/** Nombre maximum d'octets d'une lecture du maître. */
+#define I2C_LECTURE_TAILLE I2C_NOMBRE_REGISTRES_ETAT
+
+/**
+ * Opérations du MSSP maître, rendues par i2cOperationMaitre.
+ */
+typedef enum {
+    I2C_EMET,           // Écrire i2cRecupereCaracterePourEmission dans SSP1BUF.
+    I2C_REDEMARRE,      // START répété (RSEN).
+    I2C_RECOIT,         // Recevoir un octet (RCEN).
+    I2C_ACQUITTE,       // Passer SSP1BUF à i2cReceptionLecture, et acquitter (ACKEN).
+    I2C_ARRETE          // STOP (PEN).
+} OperationMaitre;
+
 typedef struct {
     Adresse adresse;
     CommandeType commande;
     unsigned char valeur;
 } Commande;
 
+/** File d'émission du maître, et file de réception de l'esclave. */
+extern File fileEmission;
+extern File fileReception;
+
+/**
+ * Compteurs de télémétrie, modifiés par les interruptions.
+ * Ils reviennent à 0 après 65535.
+ */
+/** Rafales complètement émises par le maître. */
+extern unsigned int i2cRafalesEmises;
+
+/** Rafales reçues par l'esclave, avec au moins une valeur. */
+extern unsigned int i2cRafalesRecues;
+
+/** Valeurs de la boîte aux lettres remplacées avant d'être émises. */
+extern unsigned int i2cValeursRemplacees;
+
+void i2cPrepareRafalePourEmission(Adresse adresse, CommandeType premier, unsigned char *valeurs, unsigned char nombre);
+void i2cDeposeValeurServo(Adresse adresse, CommandeType type, unsigned char valeur);
+void i2cDeposeValeurServoPrecise(Adresse adresse, CommandeType type, unsigned int valeur);
 void i2cPrepareCommandePourEmission(Adresse adresse, CommandeType type, unsigned char valeur);
 unsigned char i2cDonneesDisponiblesPourEmission();
 unsigned char i2cRecupereCaracterePourEmission();
 unsigned char i2cCommandeCompletementEmise();
+void i2cPrepareLecture(Adresse adresse, unsigned char registre, unsigned char nombre);
+OperationMaitre i2cOperationMaitre();
+unsigned char i2cReceptionLecture(unsigned char octet);
+unsigned char i2cLitLecture(unsigned char *valeurs);
 void i2cMaitre();
 
 void i2cReceptionAdresse(Adresse adresse);
@@ -27,6 +136,9 @@ void i2cReceptionDonnee(unsigned char donnee);
 void i2cFinDeReception();
 unsigned char i2cCommandeRecue();
 void i2cLitCommandeRecue(Commande *commande);
+unsigned char i2cRegistrePourLecture();
+
+Adresse i2cAdresseModule(unsigned char numero);
 
 void i2cReinitialise();
 
@@ -3,6 +3,12 @@
 #include "recepteur.h"
 #include "pwm.h"
 #include "i2c.h"
+#include "file.h"
+#include "filtre.h"
+#include "sequenceur.h"
+#include "trace.h"
+#include "cycles.h"
+#include "horloge.h"
 #include "test.h"
 
 /**
@@ -29,24 +35,101 @@ typedef enum {
 
 Mode mode;
 
+/**
+ * Point d'entrée des interruptions haute priorité.
+ * Seule la génération des impulsions PWM du récepteur l'utilise.
+ */
+void high_priority interrupt interruptionsHautePriorite() {
+    TRACE_ENREGISTRE(traceHaute, TRACE_ENTREE);
+    if (mode == RECEPTEUR) {
+        recepteurInterruptionsHautePriorite();
+    }
+    TRACE_ENREGISTRE(traceHaute, TRACE_SORTIE);
+}
+
 /**
  * Point d'entrée des interruptions basse priorité.
  */
 void low_priority interrupt interruptionsBassePriorite() {
+    TRACE_ENREGISTRE(traceBasse, TRACE_ENTREE);
     if (mode == EMETTEUR) {
         emetteurInterruptions();
     } else {
         recepteurInterruptions();
     }    
+#ifdef TRACE
+    consoleInterruptions();
+#endif
+    TRACE_ENREGISTRE(traceBasse, TRACE_SORTIE);
+}
+
+#ifdef BANC_CYCLES
+
+/**
+ * Sources d'interruption de l'émetteur et du récepteur, suivant les
+ * options de compilation. Les captures de EMETTEUR_CAPTURE et
+ * RECEPTEUR_CAPTURE ne sont pas mesurées.
+ * Avec PWM_SEQUENCEUR, la mesure de CCP4IF est le pire cas du
+ * séquenceur (voir cyclesPrepareSequenceur).
+ */
+#if defined(EMETTEUR_CAPTURE)
+#define CYCLES_EMETTEUR 0
+#elif defined(EMETTEUR_BALAYAGE)
+#define CYCLES_EMETTEUR (CYCLES_TMR0IF | CYCLES_ADIF | CYCLES_SSP1IF)
+#else
+#define CYCLES_EMETTEUR (CYCLES_INT1F | CYCLES_INT2F | CYCLES_ADIF | CYCLES_SSP1IF)
+#endif
+#if defined(PWM_SEQUENCEUR) && defined(RECEPTEUR_PWM_BASSE_PRIORITE)
+#define CYCLES_RECEPTEUR (CYCLES_SSP1IF | CYCLES_CCP4IF)
+#define CYCLES_RECEPTEUR_HAUTE 0
+#elif defined(PWM_SEQUENCEUR)
+#define CYCLES_RECEPTEUR CYCLES_SSP1IF
+#define CYCLES_RECEPTEUR_HAUTE (CYCLES_CCP4IF | CYCLES_HAUTE)
+#elif defined(RECEPTEUR_PWM_BASSE_PRIORITE)
+#define CYCLES_RECEPTEUR (CYCLES_SSP1IF | CYCLES_TMR2IF)
+#define CYCLES_RECEPTEUR_HAUTE 0
+#else
+#define CYCLES_RECEPTEUR CYCLES_SSP1IF
+#define CYCLES_RECEPTEUR_HAUTE (CYCLES_TMR2IF | CYCLES_HAUTE)
+#endif
+
+/**
+ * Point d'entrée du banc d'essai en cycles (voir cycles.h).
+ * Mesure les fonctions, puis les interruptions dans chacun des modes.
+ */
+void main(void) {
+    horlogeInitialise();
+    cyclesInitialise();
+    cyclesMesureFonctions();
+
+    mode = EMETTEUR;
+    cyclesMesureInterruptions("emetteur", CYCLES_EMETTEUR);
+
+    mode = RECEPTEUR;
+#ifdef PWM_SEQUENCEUR
+    cyclesPrepareSequenceur();
+#endif
+    cyclesMesureInterruptions("recepteur", CYCLES_RECEPTEUR);
+    cyclesMesureInterruptions("recepteurHaute", CYCLES_RECEPTEUR_HAUTE);
+
+    cyclesFin();
+    while(1);
 }
 
+#else
+
 /**
  * Point d'entrée.
  * Suivant la valeur du port B4, il lance le programme
  * en mode émetteur ou en mode récepteur.
  */
 void main(void) {
-    
+    horlogeInitialise();
+
+#ifdef TRACE
+    traceInitialise();
+#endif
+
     TRISBbits.RB4 = 1;
     ANSELBbits.ANSB4 = 0;
     
@@ -65,12 +148,29 @@ void main(void) {
     while(1);
 }
 #endif
+#endif
 
 #ifdef TEST
+/**
+ * Point d'entrée des interruptions basse priorité, pour les tests:
+ * seule la console les utilise.
+ */
+void low_priority interrupt interruptionsBassePriorite() {
+    consoleInterruptions();
+}
+
 void main() {
+    horlogeInitialise();
     initialiseTests();
+    testFile();
     testPwm();
+    testSequenceur();
     testI2c();
+    testEmetteur();
+    testFiltre();
+#ifdef TRACE
+    testTrace();
+#endif
     finaliseTests();
     while(1);
 }
@@ -0,0 +1,57 @@
+#!/bin/sh
+# Banc d'essai en cycles d'instruction (voir cycles.h).
+# Compile la configuration MPLAB "cycles", exécute le programme sous
+# gpsim jusqu'à cyclesFin, et affiche une ligne par mesure:
+#   <nom> <cycles>
+#
+# Usage, depuis la racine du projet:
+#   outils/cycles.sh > cycles.txt
+#   outils/cycles.sh cycles-reference.txt
+# Avec un fichier de référence, affiche l'écart de chaque mesure et
+# échoue si une mesure prend plus de cycles (voir hote/compare.awk).
+#
+# OPTIONS ajoute des options de compilation, et recompile tout. Par
+# exemple, pour le séquenceur (voir sequenceur.c) avec 2, 8 et 16 canaux:
+#   for n in 2 8 16; do
+#       OPTIONS="-DPWM_SEQUENCEUR -DPWM_NOMBRE_DE_CANAUX=$n" outils/cycles.sh
+#   done | grep CCP4IF
+#
+# Nécessite XC8 (make CONF=cycles) et gpsim, avec ses modules.
+set -e
+cd "$(dirname "$0")/.."
+
+make CONF=cycles clean >&2
+make CONF=cycles build MP_EXTRA_CC_PRE="$OPTIONS" >&2
+cof=$(ls dist/cycles/production/*.cof | head -n 1)
+
+# La EUSART (TX sur RC6, HORLOGE_BAUDS = 9600 bauds) est reliée à un module usart de
+# gpsim, qui affiche ce qu'il reçoit:
+commandes=$(mktemp)
+resultat=$(mktemp)
+trap 'rm -f "$commandes" "$resultat"' EXIT
+cat > "$commandes" <<FIN
+load $cof
+module library libgpsim_modules
+module load usart console
+console.rxbaud = 9600
+console.console = true
+node tx
+attach tx portc6 console.RXPIN
+break e _cyclesFin
+run
+quit
+FIN
+
+gpsim -i -c "$commandes" | tr -d '\r' \
+    | sed -n 's/^.*CYCLES \([^ ]*\) \([0-9]*\)$/\1 \2/p' > "$resultat"
+
+if [ ! -s "$resultat" ]; then
+    echo "Aucune mesure reçue de gpsim." >&2
+    exit 1
+fi
+
+if [ -n "$1" ]; then
+    awk -v tolerance=0 -f hote/compare.awk "$1" "$resultat"
+else
+    cat "$resultat"
+fi
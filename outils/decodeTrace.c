@@ -0,0 +1,159 @@
+/**
+ * Décode la trace des interruptions envoyée par le microcontrôleur
+ * (voir trace.h) et affiche, pour chaque niveau et chaque événement,
+ * un histogramme des durées en cycles d'instruction.
+ *
+ * La durée d'un événement est le temps jusqu'à l'événement suivant du
+ * même niveau. Pour TRACE_ENTREE, c'est le temps jusqu'à la sortie de
+ * l'interruption, c'est à dire la durée totale de l'interruption.
+ *
+ * Ce programme tourne sur l'ordinateur hôte:
+ *   cc -o decodeTrace outils/decodeTrace.c
+ *   stty -F /dev/ttyUSB0 9600 raw
+ *   (echo -n T; sleep 5) > /dev/ttyUSB0 & cat /dev/ttyUSB0 > trace.txt
+ *   ./decodeTrace < trace.txt
+ */
+#include <stdio.h>
+#include <string.h>
+
+/** Doit correspondre à TraceEvenement, dans trace.h. */
+static const char *nomsEvenements[] = {
+    "?", "ENTREE", "SORTIE", "TMR2IF", "SSP1IF", "ADIF",
+    "INT1F", "INT2F", "TMR0IF", "CCP4IF", "CAPTURE"
+};
+#define NOMBRE_EVENEMENTS (sizeof(nomsEvenements) / sizeof(nomsEvenements[0]))
+
+/** Les durées sont classées par puissances de 2: 1, 2, 4... 65536. */
+#define NOMBRE_CLASSES 17
+
+/** Niveaux d'interruption: 0 pour la haute priorité, 1 pour la basse. */
+#define NOMBRE_NIVEAUX 2
+
+static unsigned long histogramme[NOMBRE_NIVEAUX][NOMBRE_EVENEMENTS][NOMBRE_CLASSES];
+static unsigned int dureeMaximum[NOMBRE_NIVEAUX][NOMBRE_EVENEMENTS];
+
+/** Dernier événement reçu pour chaque niveau, ou 0. */
+static unsigned int evenementPrecedent[NOMBRE_NIVEAUX];
+static unsigned int instantPrecedent[NOMBRE_NIVEAUX];
+
+/** Instant de la dernière entrée dans l'interruption, si elle est connue. */
+static unsigned int instantEntree[NOMBRE_NIVEAUX];
+static int entreeConnue[NOMBRE_NIVEAUX];
+
+/**
+ * Rend la classe de la durée indiquée.
+ * @param duree La durée, en cycles.
+ * @return L'index de la plus petite puissance de 2 supérieure ou égale.
+ */
+static int classe(unsigned int duree) {
+    int n = 0;
+    while (n < NOMBRE_CLASSES - 1 && (1u << n) < duree) {
+        n++;
+    }
+    return n;
+}
+
+/**
+ * Comptabilise la durée de l'événement précédent du niveau indiqué.
+ * Une durée depuis un événement SORTIE n'est que le temps passé hors
+ * interruption, et n'est pas comptabilisée. Celle depuis ENTREE est
+ * remplacée par la durée totale de l'interruption.
+ */
+static void comptabilise(int niveau, unsigned int instant) {
+    unsigned int e = evenementPrecedent[niveau];
+    unsigned int duree;
+
+    if (e == 0 || e == 1 || e == 2) {
+        return;
+    }
+    // TMR5 compte sur 16 bits:
+    duree = (instant - instantPrecedent[niveau]) & 0xFFFF;
+    histogramme[niveau][e][classe(duree)]++;
+    if (duree > dureeMaximum[niveau][e]) {
+        dureeMaximum[niveau][e] = duree;
+    }
+}
+
+/**
+ * Même chose que comptabilise, mais pour la durée totale de
+ * l'interruption: de ENTREE jusqu'à SORTIE.
+ */
+static void comptabiliseInterruption(int niveau, unsigned int evenement, unsigned int instant) {
+    unsigned int duree;
+
+    if (evenement == 1) {
+        instantEntree[niveau] = instant;
+        entreeConnue[niveau] = 1;
+    } else if (evenement == 2 && entreeConnue[niveau]) {
+        duree = (instant - instantEntree[niveau]) & 0xFFFF;
+        histogramme[niveau][1][classe(duree)]++;
+        if (duree > dureeMaximum[niveau][1]) {
+            dureeMaximum[niveau][1] = duree;
+        }
+        entreeConnue[niveau] = 0;
+    }
+}
+
+static void afficheHistogrammes() {
+    int niveau, n;
+    unsigned int e;
+    unsigned long total;
+
+    for (niveau = 0; niveau < NOMBRE_NIVEAUX; niveau++) {
+        for (e = 1; e < NOMBRE_EVENEMENTS; e++) {
+            if (e == 2) {
+                continue;
+            }
+            total = 0;
+            for (n = 0; n < NOMBRE_CLASSES; n++) {
+                total += histogramme[niveau][e][n];
+            }
+            if (total == 0) {
+                continue;
+            }
+            printf("%s %s: %lu mesures, maximum %u cycles\n",
+                    niveau ? "Basse" : "Haute",
+                    e == 1 ? "INTERRUPTION" : nomsEvenements[e],
+                    total, dureeMaximum[niveau][e]);
+            for (n = 0; n < NOMBRE_CLASSES; n++) {
+                if (histogramme[niveau][e][n]) {
+                    printf("  <= %5u: %lu\n", 1u << n, histogramme[niveau][e][n]);
+                }
+            }
+        }
+    }
+}
+
+int main() {
+    char ligne[80];
+    char niveau;
+    unsigned int evenement, instant;
+    int n;
+
+    while (fgets(ligne, sizeof(ligne), stdin)) {
+        // Chaque vidage recommence la trace depuis un état inconnu:
+        if (strncmp(ligne, "TRACE", 5) == 0) {
+            for (n = 0; n < NOMBRE_NIVEAUX; n++) {
+                evenementPrecedent[n] = 0;
+                entreeConnue[n] = 0;
+            }
+            continue;
+        }
+        if (sscanf(ligne, "%c %x %x", &niveau, &evenement, &instant) != 3) {
+            continue;
+        }
+        if (niveau != 'H' && niveau != 'B') {
+            continue;
+        }
+        if (evenement == 0 || evenement >= NOMBRE_EVENEMENTS) {
+            continue;
+        }
+        n = (niveau == 'H') ? 0 : 1;
+        comptabilise(n, instant);
+        comptabiliseInterruption(n, evenement, instant);
+        evenementPrecedent[n] = evenement;
+        instantPrecedent[n] = instant;
+    }
+    afficheHistogrammes();
+    return 0;
+}
@@ -1,22 +1,182 @@
 #include "test.h"
 #include "pwm.h"
+#include "horloge.h"
 
-#define PWM_NOMBRE_DE_CANAUX 2
-#define PWM_ESPACEMENT 6
+/*
+ * Une trame est faite de plusieurs périodes du temporisateur 2, et seule
+ * la première porte une impulsion. Avec un pas de 4us, une période dure
+ * 4 * (PR2 + 1) pas, soit au plus 1024 pas (4,096ms), et au moins 
+ * 512 pas pour contenir une impulsion de 2ms.
+ */
+
+/** Durée d'une trame à la fréquence indiquée, en pas de 4us. */
+#define PWM_TRAME(hz) (250000UL / (hz))
+
+/** Nombre de périodes du temporisateur 2 par trame. */
+#define PWM_PERIODES(hz) ((PWM_TRAME(hz) + 1023) / 1024)
+
+/** PR2, pour que les périodes remplissent la trame. */
+#define PWM_PR2(hz) (PWM_TRAME(hz) / (4 * PWM_PERIODES(hz)) - 1)
 
+/** Périodes sans impulsion, après celle qui porte l'impulsion. */
+static unsigned char espacementTrame = PWM_PERIODES(PWM_FREQUENCE) - 1;
+
+/** Valeur de PR2 pour la fréquence de trame choisie. */
+static unsigned char periodeTmr2 = PWM_PR2(PWM_FREQUENCE);
+
+/** Durée de la trame choisie, en pas de 4us. */
+static unsigned int dureeTrame = PWM_TRAME(PWM_FREQUENCE);
+
+/*
+ * Une nouvelle fréquence (voir pwmChoisitFrequence) attend le début de
+ * la trame suivante pour changer l'espacement et PR2.
+ */
+
+/** Espacement de la fréquence choisie, pas encore appliqué. */
+static unsigned char espacementDemande;
+
+/** PR2 de la fréquence choisie, pas encore appliqué. */
+static unsigned char periodeDemandee;
+
+/** Indique qu'une nouvelle fréquence attend le début de la trame. */
+static volatile unsigned char frequenceDemandee = 0;
+
+/** Les 8 bits plus signifiants de la valeur PWM de chaque canal (CCPRxL). */
 static unsigned char valeurCanal[PWM_NOMBRE_DE_CANAUX];
 
+/** Les 2 bits moins signifiants de la valeur PWM de chaque canal (DCxB). */
+static unsigned char valeurCanalFine[PWM_NOMBRE_DE_CANAUX];
+
+/** Quarts de pas de 4us au-delà de la valeur PWM (voir pwmEtablitValeurPrecise). */
+static unsigned char precisionCanal[PWM_NOMBRE_DE_CANAUX];
+
+/*
+ * Les valeurs établies ci-dessus ne sont pas lues par l'interruption PWM.
+ * pwmPublie les copie toutes dans la table de réserve, et pwmEspacement
+ * bascule sur cette table au début de la trame suivante. Tous les canaux
+ * d'une même publication changent donc sur la même trame, sans masquer
+ * les interruptions.
+ */
+
+/** Valeurs publiées (CCPRxL): l'une est lue pendant la trame, l'autre en réserve. */
+static unsigned char valeurPubliee[2][PWM_NOMBRE_DE_CANAUX];
+
+/** Valeurs publiées (DCxB), dans les mêmes tables. */
+static unsigned char valeurPublieeFine[2][PWM_NOMBRE_DE_CANAUX];
+
+/** Vitesses publiées (voir pwmEtablitVitesse), dans les mêmes tables. */
+static unsigned char vitessePubliee[2][PWM_NOMBRE_DE_CANAUX];
+
+/** Table lue par l'interruption PWM. */
+static volatile unsigned char tableActive = 0;
+
+/** Indique que la table de réserve est prête à être utilisée. */
+static volatile unsigned char tablePrete = 0;
+
+/** Vitesse établie de chaque canal, en 1/16 de pas de 4us par trame. */
+static unsigned char vitesseCanal[PWM_NOMBRE_DE_CANAUX];
+
+/*
+ * Interpolation: au début de chaque trame, la position de chaque canal
+ * s'approche de la valeur publiée d'au plus sa vitesse. La position est
+ * en virgule fixe: la valeur PWM de 10 bits, et PWM_FRACTION bits de
+ * fraction. L'interruption PWM lit la valeur de sortie.
+ */
+#define PWM_FRACTION 4
+
+/** Position de chaque canal, en virgule fixe. */
+static unsigned int positionCanal[PWM_NOMBRE_DE_CANAUX];
+
+/** Les 8 bits plus signifiants de la position de chaque canal (CCPRxL). */
+static unsigned char valeurSortie[PWM_NOMBRE_DE_CANAUX];
+
+/** Les 2 bits moins signifiants de la position de chaque canal (DCxB). */
+static unsigned char valeurSortieFine[PWM_NOMBRE_DE_CANAUX];
+
+/*
+ * Table de conversion, générée à la compilation et placée en mémoire
+ * de programme. Chaque valeur générique correspond à une valeur PWM de 
+ * 10 bits entre 248 et 503, soit de 1ms à 2ms par pas de 4us.
+ */
+#define PWM_C(v) (248 + (v))
+#define PWM_C4(v) PWM_C(v), PWM_C(v + 1), PWM_C(v + 2), PWM_C(v + 3)
+#define PWM_C16(v) PWM_C4(v), PWM_C4(v + 4), PWM_C4(v + 8), PWM_C4(v + 12)
+#define PWM_C64(v) PWM_C16(v), PWM_C16(v + 16), PWM_C16(v + 32), PWM_C16(v + 48)
+
+static const unsigned int pwmTableConversion[256] = {
+    PWM_C64(0), PWM_C64(64), PWM_C64(128), PWM_C64(192)
+};
+
 /**
- * Convertit une valeur signée générique vers une valeur directement
- * utilisable pour la génération PWM.
+ * Convertit une valeur signée générique vers une valeur PWM de 10 bits.
+ * @param valeur Une valeur entre 0 et 255.
+ * @return Une valeur entre 248 et 503.
+ */
+unsigned int pwmConversionDixBits(unsigned char valeurGenerique) {
+    return pwmTableConversion[valeurGenerique];
+}
+
+/**
+ * Convertit une valeur signée générique vers les 8 bits plus
+ * signifiants de la valeur PWM.
  * @param valeur Une valeur entre 0 et 255.
  * @return Une valeur entre 62 et 125.
  */
 unsigned char pwmConversion(unsigned char valeurGenerique) {
-    unsigned char valeurPwm = valeurGenerique;
-    valeurPwm >>= 2;
-    valeurPwm += 62;
-    return valeurPwm;
+    return pwmTableConversion[valeurGenerique] >> 2;
+}
+
+/**
+ * Table de chaque canal calibré: la position, en pas de 4us après 1ms,
+ * de chaque valeur générique.
+ */
+static unsigned char tableCalibration[PWM_NOMBRE_DE_CANAUX_CALIBRES][256];
+
+/** Calibration neutre: chaque valeur générique garde sa position. */
+static const Calibration calibrationNeutre = {0, 255, 0, 0};
+
+/**
+ * Calibre un canal: reconstruit sa table, sans division sauf une par
+ * calibration. La valeur 0 va au minimum, 128 au centre (128 plus 
+ * son décalage), et 255 au maximum, linéairement entre les deux. 
+ * Inversé, le sens est retourné: 0 va au maximum.
+ * Le coût est de 256 itérations: ne doit pas être appelée par une
+ * interruption. Les valeurs déjà établies ne changent pas.
+ * @param canal Le canal.
+ * @param calibration La calibration.
+ * @return 255 si le canal est calibré, 0 s'il n'a pas de table.
+ */
+unsigned char pwmCalibre(unsigned char canal, const Calibration *calibration) {
+    unsigned char *table;
+    unsigned char n, sens, centre;
+    unsigned int position;
+    int c, pente;
+
+    if (canal >= PWM_NOMBRE_DE_CANAUX_CALIBRES) {
+        return 0;
+    }
+    table = tableCalibration[canal];
+    sens = calibration->inverse ? 255 : 0;
+    c = 128 + calibration->centre;
+    centre = (c < 0) ? 0 : ((c > 255) ? 255 : c);
+
+    // De 0 à 127, en virgule fixe 8.8, arrondi:
+    position = ((unsigned int) calibration->minimum << 8) + 128;
+    pente = ((int) centre - calibration->minimum) * 2;
+    for (n = 0; n < 128; n++) {
+        table[n ^ sens] = position >> 8;
+        position += pente;
+    }
+
+    // De 128 à 255:
+    position = ((unsigned int) centre << 8) + 128;
+    pente = ((long) calibration->maximum - centre) * 256 / 127;
+    for (n = 128; n < 255; n++) {
+        table[n ^ sens] = position >> 8;
+        position += pente;
+    }
+    table[255 ^ sens] = calibration->maximum;
+    return 255;
 }
 
 static unsigned char canalPret = 0;
@@ -30,33 +190,249 @@ void pwmPrepareValeur(unsigned char canal) {
 }
 
 /**
- * Établit la valeur du canal spécifié par {@link #pwmPrepareValeur}.
+ * Établit la valeur du canal spécifié par {@link #pwmPrepareValeur},
+ * selon sa calibration.
  * @param valeur La valeur du canal.
  */
 void pwmEtablitValeur(unsigned char valeur) {
-    valeurCanal[canalPret] = pwmConversion(valeur);
+    unsigned int valeurPwm;
+#if PWM_NOMBRE_DE_CANAUX_CALIBRES < PWM_NOMBRE_DE_CANAUX
+    if (canalPret >= PWM_NOMBRE_DE_CANAUX_CALIBRES) {
+        valeurPwm = pwmTableConversion[valeur];
+    } else {
+        valeurPwm = PWM_C(tableCalibration[canalPret][valeur]);
+    }
+#else
+    valeurPwm = PWM_C(tableCalibration[canalPret][valeur]);
+#endif
+    valeurCanal[canalPret] = valeurPwm >> 2;
+    valeurCanalFine[canalPret] = valeurPwm & 3;
+    precisionCanal[canalPret] = 0;
+}
+
+/**
+ * Établit une valeur générique de 10 bits pour le canal spécifié par 
+ * {@link #pwmPrepareValeur}, selon sa calibration. Les 2 bits de poids
+ * faible placent l'impulsion entre la position de la valeur de 8 bits
+ * et celle de la suivante, par quarts. Le PWM des CCP a un pas de 4us 
+ * et les ignore; seul le séquenceur les rend, quand l'horloge compte 
+ * plusieurs pas pour 4us (voir pwmValeurPrecision).
+ * @param valeur La valeur du canal, entre 0 et 1023.
+ */
+void pwmEtablitValeurPrecise(unsigned int valeur) {
+    unsigned char generique = valeur >> 2;
+    int ecart = 0;
+    unsigned int quarts;
+
+    pwmEtablitValeur(generique);
+    if (generique < 255) {
+#if PWM_NOMBRE_DE_CANAUX_CALIBRES < PWM_NOMBRE_DE_CANAUX
+        if (canalPret >= PWM_NOMBRE_DE_CANAUX_CALIBRES) {
+            ecart = 1;
+        } else {
+            ecart = (int) tableCalibration[canalPret][generique + 1] - tableCalibration[canalPret][generique];
+        }
+#else
+        ecart = (int) tableCalibration[canalPret][generique + 1] - tableCalibration[canalPret][generique];
+#endif
+    }
+    quarts = (pwmValeurDixBits(canalPret) << 2) + ecart * (int) (valeur & 3);
+    valeurCanal[canalPret] = quarts >> 4;
+    valeurCanalFine[canalPret] = (quarts >> 2) & 3;
+    precisionCanal[canalPret] = quarts & 3;
+}
+
+/**
+ * Établit la vitesse du canal spécifié par {@link #pwmPrepareValeur}.
+ * Les valeurs suivantes du canal sont atteintes progressivement, au 
+ * début de chaque trame, au lieu de s'appliquer d'un coup. Le maître 
+ * n'a alors besoin d'envoyer que les positions clé d'un mouvement.
+ * Avec le séquenceur, qui n'appelle pas pwmEspacement, la vitesse 
+ * est ignorée. Elle est comptée par trame: le même mouvement est plus
+ * rapide à une fréquence de trame plus élevée.
+ * @param vitesse En 1/16 de pas de 4us par trame: de 1 (1ms en 4096
+ * trames) à 255 (1ms en 17 trames). 0 pour appliquer les valeurs 
+ * directement.
+ */
+void pwmEtablitVitesse(unsigned char vitesse) {
+    vitesseCanal[canalPret] = vitesse;
+}
+
+/**
+ * Publie les valeurs établies de tous les canaux. Elles s'appliquent 
+ * ensemble, à partir de la prochaine trame (voir pwmEspacement). Une 
+ * publication plus récente, avant le début de cette trame, la remplace.
+ * Ne doit pas être appelée par l'interruption PWM.
+ */
+void pwmPublie() {
+    unsigned char n, table;
+
+    // L'interruption ne doit pas basculer pendant la copie:
+    tablePrete = 0;
+    table = tableActive ^ 1;
+    for (n = 0; n < PWM_NOMBRE_DE_CANAUX; n++) {
+        valeurPubliee[table][n] = valeurCanal[n];
+        valeurPublieeFine[table][n] = valeurCanalFine[n];
+        vitessePubliee[table][n] = vitesseCanal[n];
+    }
+    tablePrete = 255;
+}
+
+/**
+ * Rend la valeur PWM du canal pour la trame en cours: la valeur
+ * publiée, ou la position atteinte en allant vers elle.
+ * @param canal Le canal.
+ * @return Les 8 bits plus signifiants de la valeur PWM (pour CCPRxL).
+ */
+unsigned char pwmValeurPubliee(unsigned char canal) {
+    return valeurSortie[canal];
+}
+
+/**
+ * Rend les 2 bits moins signifiants de la valeur PWM du canal,
+ * pour la trame en cours.
+ * @param canal Le canal.
+ * @return Une valeur entre 0 et 3 (pour DCxB).
+ */
+unsigned char pwmValeurPublieeFine(unsigned char canal) {
+    return valeurSortieFine[canal];
 }
 
 /**
- * Rend la valeur PWM correspondante au canal.
+ * Avance la position de chaque canal vers sa valeur publiée. Un canal 
+ * sans vitesse, ou qui s'active ou se désactive, saute à sa valeur.
+ * Le coût est borné: une comparaison par canal immobile, et une 
+ * addition et un découpage par canal en mouvement.
+ */
+static void pwmInterpole() {
+    unsigned char n, table, vitesse;
+    unsigned int cible, position;
+
+    table = tableActive;
+    for (n = 0; n < PWM_NOMBRE_DE_CANAUX; n++) {
+        cible = (((unsigned int) valeurPubliee[table][n] << 2) 
+                | valeurPublieeFine[table][n]) << PWM_FRACTION;
+        position = positionCanal[n];
+        if (position != cible) {
+            vitesse = vitessePubliee[table][n];
+            if ((vitesse == 0) || (position == 0) || (cible == 0)) {
+                position = cible;
+            } else if (position < cible) {
+                position = (cible - position > vitesse) ? position + vitesse : cible;
+            } else {
+                position = (position - cible > vitesse) ? position - vitesse : cible;
+            }
+            positionCanal[n] = position;
+            position >>= PWM_FRACTION;
+            valeurSortie[n] = position >> 2;
+            valeurSortieFine[n] = position & 3;
+        }
+    }
+}
+
+/**
+ * Rend la valeur PWM établie du canal, publiée ou non.
  * @param canal Le cana.
- * @return La valeur PWM correspondante au canal.
+ * @return Les 8 bits plus signifiants de la valeur PWM (pour CCPRxL).
  */
 unsigned char pwmValeur(unsigned char canal) {
     return valeurCanal[canal];
 }
 
+/**
+ * Rend la valeur PWM complète établie du canal, publiée ou non.
+ * @param canal Le canal.
+ * @return La valeur PWM sur 10 bits, en pas de 4us. 0 si le canal est inactif.
+ */
+unsigned int pwmValeurDixBits(unsigned char canal) {
+    return ((unsigned int) valeurCanal[canal] << 2) | valeurCanalFine[canal];
+}
+
+/**
+ * Rend les 2 bits moins signifiants de la valeur PWM établie du canal.
+ * @param canal Le canal.
+ * @return Une valeur entre 0 et 3 (pour DCxB).
+ */
+unsigned char pwmValeurFine(unsigned char canal) {
+    return valeurCanalFine[canal];
+}
+
+/**
+ * Rend les quarts de pas de 4us établis au-delà de la valeur PWM du
+ * canal (voir pwmEtablitValeurPrecise).
+ * @param canal Le canal.
+ * @return Une valeur entre 0 et 3.
+ */
+unsigned char pwmValeurPrecision(unsigned char canal) {
+    return precisionCanal[canal];
+}
+
 static unsigned char espacement = 0;
 
+/**
+ * Applique la fréquence demandée, s'il y en a une.
+ */
+static void pwmAppliqueFrequence() {
+    if (frequenceDemandee) {
+        espacementTrame = espacementDemande;
+        periodeTmr2 = periodeDemandee;
+        frequenceDemandee = 0;
+    }
+}
+
+/**
+ * Choisit la fréquence de trame, à tout moment. L'espacement et la 
+ * période du temporisateur 2 (voir pwmPeriodeTmr2, que l'interruption
+ * recopie dans PR2) changent au début de la trame suivante 
+ * (voir pwmEspacement), ou tout de suite avec pwmReinitialise. Le 
+ * séquenceur prend la nouvelle durée (voir pwmDureeTrame) à sa 
+ * prochaine préparation, qui s'applique aussi en début de trame.
+ * La dernière période de la trame en cours peut être irrégulière.
+ * @param frequence La fréquence.
+ */
+void pwmChoisitFrequence(FrequenceTrame frequence) {
+    frequenceDemandee = 0;
+    espacementDemande = PWM_PERIODES(frequence) - 1;
+    periodeDemandee = PWM_PR2(frequence);
+    dureeTrame = PWM_TRAME(frequence);
+    frequenceDemandee = 255;
+}
+
+/**
+ * Rend la période du temporisateur 2 pour la fréquence de trame 
+ * appliquée. L'interruption la recopie dans PR2 au début de chaque 
+ * trame.
+ * @return La valeur de PR2.
+ */
+unsigned char pwmPeriodeTmr2() {
+    return periodeTmr2;
+}
+
+/**
+ * Rend la durée de la trame choisie, appliquée ou non.
+ * @return La durée, en pas de 4us.
+ */
+unsigned int pwmDureeTrame() {
+    return dureeTrame;
+}
+
 /**
  * Indique si il est temps d'émettre une pulsation PWM.
  * Sert à espacer les pulsation PWM pour les rendre compatibles
- * avec la norme de radio contrôle.
+ * avec la norme de radio contrôle. Au début de chaque trame, bascule 
+ * sur la dernière publication (voir pwmPublie), puis avance la position
+ * des canaux qui ont une vitesse.
  * @return 255 si il est temps d'émettre une pulse. 0 autrement.
  */
 unsigned char pwmEspacement() {
-    if (espacement++ == PWM_ESPACEMENT) {
+    if (espacement++ == espacementTrame) {
         espacement = 0;
+        pwmAppliqueFrequence();
+        if (tablePrete) {
+            tableActive ^= 1;
+            tablePrete = 0;
+        }
+        pwmInterpole();
         return 255;
     } else {
         return 0;
@@ -83,20 +459,117 @@ void pwmCompleteCapture(unsigned char canal, unsigned int instant) {
     unsigned char valeur = instant - capture[canal];
     if ((valeur >= 62) && (valeur <= 125)) {
         valeurCanal[canal] = valeur;
+        valeurCanalFine[canal] = 0;
     }
 }
 
+/** Les trois dernières valeurs capturées de chaque canal. */
+static unsigned char historiqueCapture[PWM_NOMBRE_DE_CANAUX][3];
+
+/** Position de la prochaine valeur dans l'historique, ou 3 si vide. */
+static unsigned char positionCapture[PWM_NOMBRE_DE_CANAUX];
+
 /**
- * Réinitialise le système PWM.
+ * Rend la médiane de trois valeurs.
+ */
+static unsigned char pwmMediane(unsigned char a, unsigned char b, unsigned char c) {
+    unsigned char t;
+    if (a > b) {
+        t = a;
+        a = b;
+        b = t;
+    }
+    if (b > c) {
+        b = c;
+    }
+    if (a > b) {
+        return a;
+    }
+    return b;
+}
+
+/**
+ * Complète une capture, mesurée en pas du temporisateur (voir 
+ * HORLOGE_PAS_PAR_4US), et met à jour le canal indiqué avec la 
+ * médiane des trois dernières valeurs valides. Une impulsion parasite
+ * isolée est ainsi ignorée.
+ * @param canal Le numéro de canal.
+ * @param instant L'instant de finalisation de la capture.
+ * @return 255 si la valeur du canal a été mise à jour, 0 si l'impulsion
+ * est hors de la plage de 1ms à 2ms.
+ */
+unsigned char pwmCompleteCaptureFiltree(unsigned char canal, unsigned int instant) {
+    unsigned int duree = (instant - capture[canal]) / HORLOGE_PAS_PAR_4US;
+    unsigned char *historique = historiqueCapture[canal];
+    unsigned char valeur, position;
+    unsigned int valeurPwm;
+
+    if ((duree < PWM_C(0)) || (duree > PWM_C(255))) {
+        return 0;
+    }
+    valeur = duree - PWM_C(0);
+
+    position = positionCapture[canal];
+    if (position >= 3) {
+        historique[0] = valeur;
+        historique[1] = valeur;
+        position = 2;
+    }
+    historique[position] = valeur;
+    if (++position >= 3) {
+        position = 0;
+    }
+    positionCapture[canal] = position;
+
+    valeur = pwmMediane(historique[0], historique[1], historique[2]);
+    valeurPwm = pwmTableConversion[valeur];
+    valeurCanal[canal] = valeurPwm >> 2;
+    valeurCanalFine[canal] = valeurPwm & 3;
+    return 255;
+}
+
+/**
+ * Rend la valeur générique du canal, telle que mesurée par la
+ * dernière capture filtrée.
+ * @param canal Le numéro de canal.
+ * @return Une valeur entre 0 et 255.
+ */
+unsigned char pwmValeurCapturee(unsigned char canal) {
+    unsigned char *historique = historiqueCapture[canal];
+    return pwmMediane(historique[0], historique[1], historique[2]);
+}
+
+/**
+ * Réinitialise le système PWM. Les canaux calibrés reviennent à la
+ * calibration neutre.
  */
 void pwmReinitialise() {
     unsigned char n;
     
     for (n = 0; n < PWM_NOMBRE_DE_CANAUX; n++) {
         valeurCanal[n] = 0;
+        valeurCanalFine[n] = 0;
+        precisionCanal[n] = 0;
+        valeurPubliee[0][n] = 0;
+        valeurPubliee[1][n] = 0;
+        valeurPublieeFine[0][n] = 0;
+        valeurPublieeFine[1][n] = 0;
+        vitessePubliee[0][n] = 0;
+        vitessePubliee[1][n] = 0;
+        vitesseCanal[n] = 0;
+        positionCanal[n] = 0;
+        valeurSortie[n] = 0;
+        valeurSortieFine[n] = 0;
+        positionCapture[n] = 3;
+    }
+    for (n = 0; n < PWM_NOMBRE_DE_CANAUX_CALIBRES; n++) {
+        pwmCalibre(n, &calibrationNeutre);
     }
     
+    tableActive = 0;
+    tablePrete = 0;
     espacement = 0;
+    pwmAppliqueFrequence();
 }
 
 #ifdef TEST
@@ -115,6 +588,26 @@ void testConversionPwm() {
     testeEgaliteEntiers("PWMC008", pwmConversion(251), 124);
     testeEgaliteEntiers("PWMC009", pwmConversion(255), 125);
 }
+void testConversionPwmDixBits() {
+    unsigned int n;
+
+    testeEgaliteEntiers("PWMD001", pwmConversionDixBits(  0), 248);
+    testeEgaliteEntiers("PWMD002", pwmConversionDixBits(  1), 249);
+    testeEgaliteEntiers("PWMD003", pwmConversionDixBits(  2), 250);
+    testeEgaliteEntiers("PWMD004", pwmConversionDixBits(  3), 251);
+    testeEgaliteEntiers("PWMD005", pwmConversionDixBits(128), 376);
+    testeEgaliteEntiers("PWMD006", pwmConversionDixBits(255), 503);
+
+    // Chaque valeur générique donne une position différente:
+    for (n = 1; n < 256; n++) {
+        if (testeEgaliteEntiers("PWMD007", pwmConversionDixBits(n) - pwmConversionDixBits(n - 1), 1)) {
+            return;
+        }
+        if (testeEgaliteEntiers("PWMD008", pwmConversionDixBits(n) >> 2, pwmConversion(n))) {
+            return;
+        }
+    }
+}
 void testEtablitEtLitValeurPwm() {
     pwmReinitialise();
     
@@ -127,24 +620,300 @@ void testEtablitEtLitValeurPwm() {
     pwmEtablitValeur(180);
     testeEgaliteEntiers("PWMV03", pwmValeur(0), pwmConversion( 80));
     testeEgaliteEntiers("PWMV04", pwmValeur(1), pwmConversion(180));
+    
+    testeEgaliteEntiers("PWMV05", pwmValeurFine(0), pwmConversionDixBits( 80) & 3);
+    testeEgaliteEntiers("PWMV06", pwmValeurFine(1), pwmConversionDixBits(180) & 3);
+
+    pwmPrepareValeur(0);
+    pwmEtablitValeur(81);
+    testeEgaliteEntiers("PWMV07", pwmValeur(0), pwmConversion(80));
+    testeEgaliteEntiers("PWMV08", pwmValeurFine(0), (pwmConversionDixBits(80) & 3) + 1);
 }
+/** Fréquences de trame supportées, pour les tests. */
+static const FrequenceTrame frequencesTrame[] = {
+    PWM_50HZ, PWM_100HZ, PWM_200HZ, PWM_250HZ, PWM_333HZ
+};
+
 void testEspacementPwm() {
+    unsigned char f, n, periodes;
+    unsigned long duree;
+
+    for (f = 0; f < sizeof(frequencesTrame) / sizeof(frequencesTrame[0]); f++) {
+        pwmChoisitFrequence(frequencesTrame[f]);
+        pwmReinitialise();
+        periodes = PWM_PERIODES(frequencesTrame[f]);
+
+        // Une période contient l'impulsion la plus longue, et le 
+        // temporisateur 2 peut la compter:
+        if (testeEgaliteEntiers("PWME02", pwmPeriodeTmr2() >= (PWM_C(255) + 3) / 4, 1)) {
+            break;
+        }
+        
+        // Les périodes remplissent la trame à 1% près:
+        duree = 4UL * (pwmPeriodeTmr2() + 1) * periodes;
+        if (testeEgaliteEntiers("PWME03", (duree <= pwmDureeTrame()) 
+                && (duree * 100 >= pwmDureeTrame() * 99UL), 1)) {
+            break;
+        }
+        testeEgaliteEntiers("PWME04", pwmDureeTrame(), 250000UL / frequencesTrame[f]);
+
+        // Une impulsion par trame:
+        for (n = 1; n < periodes; n++) {
+            testeEgaliteEntiers("PWME00", pwmEspacement(), 0);
+        }
+        testeEgaliteEntiers("PWME01", pwmEspacement(), 255);
+
+        for (n = 1; n < periodes; n++) {
+            testeEgaliteEntiers("PWME00", pwmEspacement(), 0);
+        }
+        testeEgaliteEntiers("PWME01", pwmEspacement(), 255);
+    }
+    pwmChoisitFrequence(PWM_FREQUENCE);
+}
+/**
+ * Avance jusqu'au début de la trame suivante.
+ */
+static void pwmAvanceTrame() {
+    while (!pwmEspacement());
+}
+
+void testPublicationPwm() {
+    pwmReinitialise();
+
+    // Les valeurs établies ne sont pas lues avant leur publication:
+    pwmPrepareValeur(0);
+    pwmEtablitValeur(80);
+    pwmPrepareValeur(1);
+    pwmEtablitValeur(180);
+    pwmAvanceTrame();
+    testeEgaliteEntiers("PWMP01", pwmValeurPubliee(0), 0);
+    testeEgaliteEntiers("PWMP02", pwmValeurPubliee(1), 0);
+
+    // Ni après leur publication, avant le début de la trame suivante:
+    pwmPublie();
+    testeEgaliteEntiers("PWMP03", pwmValeurPubliee(0), 0);
+    pwmAvanceTrame();
+    testeEgaliteEntiers("PWMP04", pwmValeurPubliee(0), pwmConversion(80));
+    testeEgaliteEntiers("PWMP05", pwmValeurPubliee(1), pwmConversion(180));
+    testeEgaliteEntiers("PWMP06", pwmValeurPublieeFine(0), pwmConversionDixBits(80) & 3);
+    testeEgaliteEntiers("PWMP07", pwmValeurPublieeFine(1), pwmConversionDixBits(180) & 3);
+
+    // Les valeurs établies après une publication attendent la suivante:
+    pwmPrepareValeur(0);
+    pwmEtablitValeur(100);
+    pwmPublie();
+    pwmPrepareValeur(1);
+    pwmEtablitValeur(200);
+    pwmAvanceTrame();
+    testeEgaliteEntiers("PWMP08", pwmValeurPubliee(0), pwmConversion(100));
+    testeEgaliteEntiers("PWMP09", pwmValeurPubliee(1), pwmConversion(180));
+
+    // Une trame sans publication garde les valeurs publiées:
+    pwmAvanceTrame();
+    testeEgaliteEntiers("PWMP10", pwmValeurPubliee(1), pwmConversion(180));
+
+    // Deux publications dans la même trame: la dernière l'emporte:
+    pwmPublie();
+    pwmPrepareValeur(0);
+    pwmEtablitValeur(120);
+    pwmPublie();
+    pwmAvanceTrame();
+    testeEgaliteEntiers("PWMP11", pwmValeurPubliee(0), pwmConversion(120));
+    testeEgaliteEntiers("PWMP12", pwmValeurPubliee(1), pwmConversion(200));
+}
+
+/**
+ * Rend la valeur PWM de 10 bits du canal pour la trame en cours.
+ */
+static unsigned int pwmSortieDixBits(unsigned char canal) {
+    return ((unsigned int) pwmValeurPubliee(canal) << 2) | pwmValeurPublieeFine(canal);
+}
+
+void testFrequenceEnCoursPwm() {
     unsigned char n;
-    
+
+    pwmChoisitFrequence(PWM_50HZ);
     pwmReinitialise();
+    pwmAvanceTrame();
 
-    for (n = 0; n < PWM_ESPACEMENT; n++) {
-        testeEgaliteEntiers("PWME00", pwmEspacement(), 0);
+    // La trame en cours se termine à l'ancienne fréquence:
+    pwmChoisitFrequence(PWM_333HZ);
+    testeEgaliteEntiers("PWMR01", pwmPeriodeTmr2(), PWM_PR2(PWM_50HZ));
+    testeEgaliteEntiers("PWMR02", pwmDureeTrame(), PWM_TRAME(PWM_333HZ));
+    for (n = 1; n < PWM_PERIODES(PWM_50HZ); n++) {
+        testeEgaliteEntiers("PWMR03", pwmEspacement(), 0);
     }
 
-    testeEgaliteEntiers("PWME01", pwmEspacement(), 255);
-    
-    for (n = 0; n < PWM_ESPACEMENT; n++) {
-        testeEgaliteEntiers("PWME00", pwmEspacement(), 0);
+    // La nouvelle s'applique au début de la suivante:
+    testeEgaliteEntiers("PWMR04", pwmEspacement(), 255);
+    testeEgaliteEntiers("PWMR05", pwmPeriodeTmr2(), PWM_PR2(PWM_333HZ));
+    for (n = 1; n < PWM_PERIODES(PWM_333HZ); n++) {
+        testeEgaliteEntiers("PWMR06", pwmEspacement(), 0);
+    }
+    testeEgaliteEntiers("PWMR07", pwmEspacement(), 255);
+
+    pwmChoisitFrequence(PWM_FREQUENCE);
+    pwmReinitialise();
+}
+
+void testInterpolationPwm() {
+    unsigned char n;
+
+    pwmReinitialise();
+
+    // Un canal qui s'active saute à sa valeur, même avec une vitesse:
+    pwmPrepareValeur(0);
+    pwmEtablitVitesse(32);
+    pwmEtablitValeur(100);
+    pwmPublie();
+    pwmAvanceTrame();
+    testeEgaliteEntiers("PWMI01", pwmSortieDixBits(0), pwmConversionDixBits(100));
+
+    // Ensuite, il avance de 2 pas (32 / 16) par trame:
+    pwmEtablitValeur(105);
+    pwmPublie();
+    pwmAvanceTrame();
+    testeEgaliteEntiers("PWMI02", pwmSortieDixBits(0), pwmConversionDixBits(102));
+    pwmAvanceTrame();
+    testeEgaliteEntiers("PWMI03", pwmSortieDixBits(0), pwmConversionDixBits(104));
+    pwmAvanceTrame();
+    testeEgaliteEntiers("PWMI04", pwmSortieDixBits(0), pwmConversionDixBits(105));
+    pwmAvanceTrame();
+    testeEgaliteEntiers("PWMI05", pwmSortieDixBits(0), pwmConversionDixBits(105));
+
+    // Dans les deux sens, et avec des fractions de pas:
+    pwmEtablitVitesse(8);
+    pwmEtablitValeur(103);
+    pwmPublie();
+    pwmAvanceTrame();
+    testeEgaliteEntiers("PWMI06", pwmSortieDixBits(0), pwmConversionDixBits(104));
+    pwmAvanceTrame();
+    testeEgaliteEntiers("PWMI07", pwmSortieDixBits(0), pwmConversionDixBits(104));
+    for (n = 0; n < 2; n++) {
+        pwmAvanceTrame();
+    }
+    testeEgaliteEntiers("PWMI08", pwmSortieDixBits(0), pwmConversionDixBits(103));
+
+    // Une nouvelle valeur en cours de route repart de la position:
+    pwmEtablitVitesse(255);
+    pwmEtablitValeur(255);
+    pwmPublie();
+    pwmAvanceTrame();
+    testeEgaliteEntiers("PWMI09", pwmSortieDixBits(0), pwmConversionDixBits(103) + 15);
+    pwmEtablitValeur(0);
+    pwmPublie();
+    pwmAvanceTrame();
+    testeEgaliteEntiers("PWMI10", pwmSortieDixBits(0), pwmConversionDixBits(103));
+
+    // Sans vitesse, la valeur s'applique directement:
+    pwmEtablitVitesse(0);
+    pwmEtablitValeur(200);
+    pwmPublie();
+    pwmAvanceTrame();
+    testeEgaliteEntiers("PWMI11", pwmSortieDixBits(0), pwmConversionDixBits(200));
+
+    // Les autres canaux ne bougent pas:
+    testeEgaliteEntiers("PWMI12", pwmSortieDixBits(1), 0);
+}
+
+void testCalibrationPwm() {
+    Calibration calibration;
+    unsigned int n, precedente;
+
+    pwmReinitialise();
+
+    // La calibration neutre garde la conversion standard:
+    for (n = 0; n < 256; n++) {
+        pwmPrepareValeur(0);
+        pwmEtablitValeur(n);
+        if (testeEgaliteEntiers("PWMK01", pwmValeurDixBits(0), pwmConversionDixBits(n))) {
+            break;
+        }
+    }
+
+    // Extrémités:
+    calibration.minimum = 20;
+    calibration.maximum = 200;
+    calibration.centre = 0;
+    calibration.inverse = 0;
+    testeEgaliteEntiers("PWMK02", pwmCalibre(0, &calibration), 255);
+    pwmPrepareValeur(0);
+    pwmEtablitValeur(0);
+    testeEgaliteEntiers("PWMK03", pwmValeurDixBits(0), pwmConversionDixBits(20));
+    pwmEtablitValeur(128);
+    testeEgaliteEntiers("PWMK04", pwmValeurDixBits(0), pwmConversionDixBits(128));
+    pwmEtablitValeur(255);
+    testeEgaliteEntiers("PWMK05", pwmValeurDixBits(0), pwmConversionDixBits(200));
+    pwmEtablitValeur(64);
+    testeEgaliteEntiers("PWMK06", pwmValeurDixBits(0), pwmConversionDixBits(74));
+
+    // L'autre canal n'a pas changé:
+    pwmPrepareValeur(1);
+    pwmEtablitValeur(0);
+    testeEgaliteEntiers("PWMK07", pwmValeurDixBits(1), pwmConversionDixBits(0));
+
+    // Décalage du centre, et sens inversé:
+    calibration.centre = -8;
+    calibration.inverse = 255;
+    pwmCalibre(0, &calibration);
+    pwmPrepareValeur(0);
+    pwmEtablitValeur(0);
+    testeEgaliteEntiers("PWMK08", pwmValeurDixBits(0), pwmConversionDixBits(200));
+    pwmEtablitValeur(255);
+    testeEgaliteEntiers("PWMK09", pwmValeurDixBits(0), pwmConversionDixBits(20));
+    pwmEtablitValeur(127);
+    testeEgaliteEntiers("PWMK10", pwmValeurDixBits(0), pwmConversionDixBits(120));
+
+    // Toujours monotone (décroissante, car inversée):
+    for (n = 1; n < 256; n++) {
+        pwmEtablitValeur(n - 1);
+        precedente = pwmValeurDixBits(0);
+        pwmEtablitValeur(n);
+        if (testeEgaliteEntiers("PWMK11", pwmValeurDixBits(0) <= precedente, 1)) {
+            break;
+        }
     }
 
-    testeEgaliteEntiers("PWME01", pwmEspacement(), 255);    
+    // Les canaux au-delà de PWM_NOMBRE_DE_CANAUX_CALIBRES n'ont pas de table:
+    testeEgaliteEntiers("PWMK12", pwmCalibre(PWM_NOMBRE_DE_CANAUX_CALIBRES, &calibration), 0);
+
+    pwmReinitialise();
 }
+
+void testValeurPrecisePwm() {
+    Calibration calibration = {0, 255, 0, 255};
+
+    pwmReinitialise();
+
+    // Sans calibration, chaque quart s'ajoute à la valeur de 8 bits:
+    pwmPrepareValeur(0);
+    pwmEtablitValeurPrecise((128 << 2) | 1);
+    testeEgaliteEntiers("PWMX01", pwmValeurDixBits(0), pwmConversionDixBits(128));
+    testeEgaliteEntiers("PWMX02", pwmValeurPrecision(0), 1);
+    pwmEtablitValeurPrecise((128 << 2) | 3);
+    testeEgaliteEntiers("PWMX03", pwmValeurPrecision(0), 3);
+
+    // Rien au-delà de la valeur 255:
+    pwmEtablitValeurPrecise((255 << 2) | 3);
+    testeEgaliteEntiers("PWMX04", pwmValeurDixBits(0), pwmConversionDixBits(255));
+    testeEgaliteEntiers("PWMX05", pwmValeurPrecision(0), 0);
+
+    // Une valeur de 8 bits efface les quarts:
+    pwmEtablitValeurPrecise((128 << 2) | 2);
+    pwmEtablitValeur(128);
+    testeEgaliteEntiers("PWMX06", pwmValeurPrecision(0), 0);
+
+    // Inversé, les quarts vont vers la position de la valeur suivante,
+    // donc en arrière:
+    pwmCalibre(0, &calibration);
+    pwmPrepareValeur(0);
+    pwmEtablitValeurPrecise((10 << 2) | 1);
+    testeEgaliteEntiers("PWMX07", pwmValeurDixBits(0), pwmConversionDixBits(244));
+    testeEgaliteEntiers("PWMX08", pwmValeurPrecision(0), 3);
+
+    pwmReinitialise();
+}
+
 void testCapturePwm() {
     
     pwmDemarreCapture(0, 0);
@@ -165,11 +934,56 @@ void testCapturePwm() {
     testeEgaliteEntiers("PWMC02a", pwmValeur(0), 90);
     testeEgaliteEntiers("PWMC02b", pwmValeur(1), 100);    
 }
+
+/** Durée en pas du temporisateur de capture (voir horloge.h). */
+#define PWM_PAS(v) ((v) * HORLOGE_PAS_PAR_4US)
+
+void testCaptureFiltreePwm() {
+    pwmReinitialise();
+
+    // Une première impulsion de 1.5ms est appliquée directement:
+    pwmDemarreCapture(0, 1000);
+    testeEgaliteEntiers("PWMF01", pwmCompleteCaptureFiltree(0, 1000 + PWM_PAS(PWM_C(128))), 255);
+    testeEgaliteEntiers("PWMF02", pwmValeurCapturee(0), 128);
+    testeEgaliteEntiers("PWMF03", pwmValeur(0), pwmConversion(128));
+    testeEgaliteEntiers("PWMF04", pwmValeurFine(0), pwmConversionDixBits(128) & 3);
+
+    // Une impulsion parasite isolée est ignorée:
+    pwmDemarreCapture(0, 6000);
+    testeEgaliteEntiers("PWMF05", pwmCompleteCaptureFiltree(0, 6000 + PWM_PAS(PWM_C(250))), 255);
+    testeEgaliteEntiers("PWMF06", pwmValeurCapturee(0), 128);
+
+    // Deux impulsions de suite sont retenues:
+    pwmDemarreCapture(0, 11000);
+    pwmCompleteCaptureFiltree(0, 11000 + PWM_PAS(PWM_C(130)));
+    pwmDemarreCapture(0, 16000);
+    pwmCompleteCaptureFiltree(0, 16000 + PWM_PAS(PWM_C(130)));
+    testeEgaliteEntiers("PWMF07", pwmValeurCapturee(0), 130);
+    
+    // Les impulsions hors de la plage 1ms - 2ms sont rejetées:
+    pwmDemarreCapture(1, 0);
+    testeEgaliteEntiers("PWMF08", pwmCompleteCaptureFiltree(1, PWM_PAS(PWM_C(0)) - 1), 0);
+    testeEgaliteEntiers("PWMF09", pwmCompleteCaptureFiltree(1, PWM_PAS(PWM_C(255) + 1)), 0);
+    testeEgaliteEntiers("PWMF10", pwmValeur(1), 0);
+
+    // Le temporisateur peut déborder pendant l'impulsion:
+    pwmDemarreCapture(1, 65500);
+    testeEgaliteEntiers("PWMF11", pwmCompleteCaptureFiltree(1, 65500 + PWM_PAS(PWM_C(10))), 255);
+    testeEgaliteEntiers("PWMF12", pwmValeurCapturee(1), 10);
+}
+
 void testPwm() {    
     testConversionPwm();
+    testConversionPwmDixBits();
     testEtablitEtLitValeurPwm();
     testEspacementPwm();
+    testPublicationPwm();
+    testFrequenceEnCoursPwm();
+    testInterpolationPwm();
+    testCalibrationPwm();
+    testValeurPrecisePwm();
     testCapturePwm();
+    testCaptureFiltreePwm();
 }
 
 #endif
\ No newline at end of file
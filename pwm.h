@@ -1,12 +1,79 @@
 #ifndef PWM__TEST
 #define PWM__TEST
 
+/**
+ * Nombre de canaux PWM. Au delà de 2, il faut utiliser le séquenceur
+ * (voir sequenceur.c), car il n'y a que deux modules CCP en mode PWM.
+ */
+#ifndef PWM_NOMBRE_DE_CANAUX
+#define PWM_NOMBRE_DE_CANAUX 2
+#endif
+
+/**
+ * Nombre de canaux calibrés, à partir du canal 0 (voir pwmCalibre).
+ * Chacun a sa table de 256 octets en RAM. Les autres canaux suivent la
+ * conversion standard.
+ */
+#ifndef PWM_NOMBRE_DE_CANAUX_CALIBRES
+#define PWM_NOMBRE_DE_CANAUX_CALIBRES 2
+#endif
+
+#if PWM_NOMBRE_DE_CANAUX_CALIBRES > PWM_NOMBRE_DE_CANAUX
+#error "PWM_NOMBRE_DE_CANAUX_CALIBRES dépasse PWM_NOMBRE_DE_CANAUX"
+#endif
+
+/**
+ * Calibration d'un canal. Les positions sont en pas de 4us après 1ms,
+ * comme les valeurs génériques. Les champs sont dans l'ordre des
+ * registres CALIBRATION1 (voir i2c.h).
+ */
+typedef struct {
+    unsigned char minimum;      // Position de la valeur 0.
+    unsigned char maximum;      // Position de la valeur 255.
+    signed char centre;         // Décalage de la position de la valeur 128.
+    unsigned char inverse;      // 0, ou autre chose pour inverser le sens.
+} Calibration;
+
+/**
+ * Fréquences de trame supportées, en Hz (voir pwmChoisitFrequence).
+ * Les servos analogiques demandent 50Hz. La plupart des servos 
+ * numériques acceptent jusqu'à 333Hz: une nouvelle valeur attend
+ * alors au plus 3ms avant d'être appliquée, au lieu de 20ms.
+ * Au-delà, la trame ne laisse plus de place à une impulsion de 2ms.
+ */
+typedef enum {
+    PWM_50HZ = 50,
+    PWM_100HZ = 100,
+    PWM_200HZ = 200,
+    PWM_250HZ = 250,
+    PWM_333HZ = 333
+} FrequenceTrame;
+
+/** Fréquence de trame au démarrage. */
+#ifndef PWM_FREQUENCE
+#define PWM_FREQUENCE PWM_50HZ
+#endif
+
 unsigned char pwmValeur(unsigned char canal);
+unsigned char pwmValeurFine(unsigned char canal);
+unsigned int pwmValeurDixBits(unsigned char canal);
+unsigned char pwmValeurPrecision(unsigned char canal);
 void pwmPrepareValeur(unsigned char canal);
 void pwmEtablitValeur(unsigned char valeur);
+void pwmEtablitValeurPrecise(unsigned int valeur);
+void pwmEtablitVitesse(unsigned char vitesse);
+unsigned char pwmCalibre(unsigned char canal, const Calibration *calibration);
+void pwmPublie();
+unsigned char pwmValeurPubliee(unsigned char canal);
+unsigned char pwmValeurPublieeFine(unsigned char canal);
 unsigned char pwmEspacement();
+void pwmChoisitFrequence(FrequenceTrame frequence);
+unsigned char pwmPeriodeTmr2();
+unsigned int pwmDureeTrame();
 void pwmDemarreCapture(unsigned char canal, unsigned int instant);
 void pwmCompleteCapture(unsigned char canal, unsigned int instant);
+unsigned char pwmCompleteCaptureFiltree(unsigned char canal, unsigned int instant);
+unsigned char pwmValeurCapturee(unsigned char canal);
 void pwmReinitialise();
 
 #ifdef TEST
@@ -2,54 +2,597 @@
 #include "pwm.h"
 #include "test.h"
 #include "i2c.h"
+#include "sequenceur.h"
+#include "capture.h"
+#include "trace.h"
+#include "veille.h"
+#include "horloge.h"
+
+/*
+ * Options de compilation (à définir dans les options du projet):
+ *
+ * PWM_SEQUENCEUR: Les impulsions sont générées par le séquenceur sur
+ * des sorties digitales, au lieu des modules CCP1 et CCP3. Nécessaire
+ * pour plus de 2 canaux (PWM_NOMBRE_DE_CANAUX).
+ *
+ * PWM_FREQUENCE: Fréquence des trames, en Hz, parmi celles de 
+ * FrequenceTrame (voir pwm.h). 50 par défaut; jusqu'à 333 pour des 
+ * servos numériques.
+ *
+ * RECEPTEUR_APPLICATION_DIRECTE: Les commandes reçues sont appliquées
+ * par l'interruption, dès la fin de la rafale (STOP ou START répété),
+ * au lieu d'attendre que la boucle principale les récupère. La boucle
+ * principale reste libre.
+ *
+ * RECEPTEUR_CAPTURE: Les sorties reproduisent les impulsions mesurées
+ * sur les entrées de capture (voir capture.c), filtrées, sans attendre
+ * de commande I2C. Avec PWM_SEQUENCEUR, au plus 4 canaux: RA4 et RC1
+ * sont des entrées.
+ *
+ * RECEPTEUR_PWM_BASSE_PRIORITE: La génération des impulsions (TMR2, ou
+ * CCP4 pour le séquenceur) est traitée par l'interruption de basse 
+ * priorité, avec I2C et les captures, au lieu de l'interruption de haute 
+ * priorité. Sert à comparer les deux configurations.
+ *
+ * RECEPTEUR_MESURE_GIGUE: Mesure le retard entre l'événement PWM (fin de
+ * période de TMR2, ou comparaison du CCP4) et son traitement. Les retards
+ * minimum et maximum, en cycles d'instruction, sont disponibles dans 
+ * recepteurRetardPwmMinimum et recepteurRetardPwmMaximum; leur écart 
+ * est la gigue. Avec le séquenceur, cette gigue se retrouve directement 
+ * sur les fronts des impulsions. Avec CCP1 et CCP3, les valeurs sont
+ * tamponnées par le matériel, et le retard ne doit simplement pas 
+ * dépasser une période de TMR2.
+ *
+ * RECEPTEUR_MESURE_LATENCE: Mesure, avec le temporisateur 5, le délai
+ * entre la fin de la rafale (STOP ou START répété) et la publication
+ * de ses commandes. Si plusieurs rafales attendent, le délai est compté
+ * depuis la fin de la plus ancienne. Le dernier délai et 
+ * le délai maximum, en cycles d'instruction, sont disponibles dans 
+ * recepteurLatence et recepteurLatenceMaximum.
+ */
+
+#if (PWM_NOMBRE_DE_CANAUX > 2) && !defined(PWM_SEQUENCEUR)
+#error "Plus de 2 canaux PWM nécessitent PWM_SEQUENCEUR"
+#endif
+
+#if defined(PWM_SEQUENCEUR) && defined(RECEPTEUR_CAPTURE) && (PWM_NOMBRE_DE_CANAUX > 4)
+#error "Les entrées de capture RA4 et RC1 sont les canaux 4 et 13 du séquenceur"
+#endif
+
+#if (HORLOGE_MHZ > 4) && !defined(PWM_SEQUENCEUR)
+#error "Au-delà de 4MHz, le PWM des CCP nécessite PWM_SEQUENCEUR (voir horloge.h)"
+#endif
+
+#ifdef RECEPTEUR_MESURE_LATENCE
+/** Instant de la fin de la plus ancienne rafale pas encore publiée. */
+static unsigned int instantStop;
+
+/** Dernier délai entre le STOP et la publication des commandes. */
+unsigned int recepteurLatence = 0;
+
+/** Délai maximum entre le STOP et la publication des commandes. */
+unsigned int recepteurLatenceMaximum = 0;
 
 /**
- * Point d'entrée des interruptions basse priorité.
+ * Lit le temporisateur 5 (TMR5L d'abord, pour verrouiller TMR5H).
+ * Hors des interruptions, GIEL doit être masqué: une interruption 
+ * qui lirait TMR5L entre-temps changerait la copie de TMR5H.
+ * @return Le temps écoulé, en cycles d'instruction.
  */
-void recepteurInterruptions() {
+static unsigned int recepteurChronometre() {
+    unsigned int instant = TMR5L;
+    instant |= (unsigned int) TMR5H << 8;
+    return instant;
+}
+
+/**
+ * Lit, sans être interrompu par la réception, l'instant de la fin de
+ * la plus ancienne rafale en attente.
+ * @return L'instant, en cycles d'instruction.
+ */
+static unsigned int recepteurInstantStop() {
+    unsigned int instant;
+#ifndef RECEPTEUR_APPLICATION_DIRECTE
+    INTCONbits.GIEL = 0;
+#endif
+    instant = instantStop;
+#ifndef RECEPTEUR_APPLICATION_DIRECTE
+    INTCONbits.GIEL = 1;
+#endif
+    return instant;
+}
+
+/**
+ * Note le délai écoulé depuis l'instant indiqué.
+ * @param debut L'instant de la fin de la rafale.
+ */
+static void recepteurMesureLatence(unsigned int debut) {
+    unsigned int fin;
+#ifndef RECEPTEUR_APPLICATION_DIRECTE
+    INTCONbits.GIEL = 0;
+#endif
+    fin = recepteurChronometre();
+#ifndef RECEPTEUR_APPLICATION_DIRECTE
+    INTCONbits.GIEL = 1;
+#endif
+    // Sur 16 bits, comme le temporisateur, même sur l'hôte:
+    recepteurLatence = (fin - debut) & 0xFFFF;
+    if (recepteurLatence > recepteurLatenceMaximum) {
+        recepteurLatenceMaximum = recepteurLatence;
+    }
+}
+#endif
+
+/** Trace du niveau d'interruption qui génère les impulsions. */
+#ifdef RECEPTEUR_PWM_BASSE_PRIORITE
+#define TRACE_PWM traceBasse
+#else
+#define TRACE_PWM traceHaute
+#endif
+
+#ifdef RECEPTEUR_MESURE_GIGUE
+/** Retard minimum de traitement d'un événement PWM. */
+unsigned int recepteurRetardPwmMinimum = 0xFFFF;
+
+/** Retard maximum de traitement d'un événement PWM. */
+unsigned int recepteurRetardPwmMaximum = 0;
+
+/**
+ * Prend en compte le retard de traitement d'un événement PWM.
+ * @param retard Le retard, en cycles d'instruction.
+ */
+static void recepteurMesureRetardPwm(unsigned int retard) {
+    if (retard < recepteurRetardPwmMinimum) {
+        recepteurRetardPwmMinimum = retard;
+    }
+    if (retard > recepteurRetardPwmMaximum) {
+        recepteurRetardPwmMaximum = retard;
+    }
+}
+#endif
+
+/** Dernière valeur appliquée à chaque canal, pour les registres SERVO1... */
+static unsigned char valeurRecue[PWM_NOMBRE_DE_CANAUX];
+
+/** Bits de poids faible de la dernière valeur de chaque canal (PRECIS1...). */
+static unsigned char precisionRecue[PWM_NOMBRE_DE_CANAUX];
+
+/** Calibration reçue de chaque canal calibré, pour les registres CALIBRATION1... */
+static unsigned char calibrationRecue[PWM_NOMBRE_DE_CANAUX_CALIBRES][I2C_TAILLE_CALIBRATION];
+
+/** Indique, pour chaque canal calibré, que sa table doit être reconstruite. */
+static volatile unsigned char calibrationModifiee[PWM_NOMBRE_DE_CANAUX_CALIBRES];
+
+/** Octets perdus par le MSSP (SSPOV), pour ETAT_DEBORDEMENTS. */
+static unsigned char debordements = 0;
+
+/** Écritures refusées de SSP1BUF (WCOL), pour ETAT_COLLISIONS. */
+static unsigned char collisions = 0;
+
+/**
+ * Rend la valeur d'un registre lu par le maître.
+ * @param registre Le registre (voir RegistreEtat).
+ * @return La valeur du registre, ou 0 s'il n'existe pas.
+ */
+static unsigned char recepteurLitRegistre(unsigned char registre) {
+    unsigned char canal, precis;
+
+    switch (registre) {
+        case ETAT_VERSION:
+            return I2C_VERSION;
+        case ETAT_CANAUX:
+            return PWM_NOMBRE_DE_CANAUX;
+        case ETAT_FILE_OCCUPATION:
+            return fileReception.fileEntree - fileReception.fileSortie;
+        case ETAT_FILE_MAXIMUM:
+            return fileReception.maximum;
+        case ETAT_FILE_REJETES:
+            return fileReception.rejetes & 0xFF;
+        case ETAT_FILE_REJETES + 1:
+            return fileReception.rejetes >> 8;
+        case ETAT_RAFALES_RECUES:
+            return i2cRafalesRecues & 0xFF;
+        case ETAT_RAFALES_RECUES + 1:
+            return i2cRafalesRecues >> 8;
+        case ETAT_DEBORDEMENTS:
+            return debordements;
+        case ETAT_COLLISIONS:
+            return collisions;
+        case TRAME:
+            return pwmDureeTrame() / 250;
+    }
+    canal = registre - SERVO1;
+    if (canal < PWM_NOMBRE_DE_CANAUX) {
+        return valeurRecue[canal];
+    }
+    precis = registre - PRECIS1;
+    canal = precis / I2C_TAILLE_PRECIS;
+    if (canal < PWM_NOMBRE_DE_CANAUX) {
+        return (precis & 1) ? precisionRecue[canal] : valeurRecue[canal];
+    }
+    registre -= CALIBRATION1;
+    canal = registre / I2C_TAILLE_CALIBRATION;
+    if (canal < PWM_NOMBRE_DE_CANAUX_CALIBRES) {
+        return calibrationRecue[canal][registre % I2C_TAILLE_CALIBRATION];
+    }
+    return 0;
+}
+
+/**
+ * Envoie au maître le prochain registre, et libère l'horloge.
+ */
+static void recepteurEmetRegistre() {
+    SSP1CON1bits.WCOL = 0;
+    SSP1BUF = recepteurLitRegistre(i2cRegistrePourLecture());
+    if (SSP1CON1bits.WCOL) {
+        collisions++;
+        SSP1CON1bits.WCOL = 0;
+    }
+    SSP1CON1bits.CKP = 1;
+}
+
+/**
+ * Choisit la fréquence de trame selon sa durée. Une durée qui ne 
+ * correspond à aucune fréquence supportée est ignorée.
+ * @param duree La durée de la trame, en ms.
+ */
+static void recepteurChoisitTrame(unsigned char duree) {
+    switch (duree) {
+        case 20:
+            pwmChoisitFrequence(PWM_50HZ);
+            break;
+        case 10:
+            pwmChoisitFrequence(PWM_100HZ);
+            break;
+        case 5:
+            pwmChoisitFrequence(PWM_200HZ);
+            break;
+        case 4:
+            pwmChoisitFrequence(PWM_250HZ);
+            break;
+        case 3:
+            pwmChoisitFrequence(PWM_333HZ);
+            break;
+    }
+}
+
+/**
+ * Applique la commande indiquée au canal PWM correspondant: sa valeur,
+ * de 8 ou 10 bits, sa vitesse, ou un champ de sa calibration. La table
+ * du canal est reconstruite plus tard, par la boucle principale. 
+ * Applique aussi la fréquence de trame.
+ * @param commande La commande.
+ */
+static void recepteurAppliqueCommande(Commande *commande) {
+    unsigned char registre;
+    unsigned char canal = commande->commande - SERVO1;
+    if (commande->commande == TRAME) {
+        recepteurChoisitTrame(commande->valeur);
+    }
+    if (canal < PWM_NOMBRE_DE_CANAUX) {
+        valeurRecue[canal] = commande->valeur;
+        precisionRecue[canal] = 0;
+        pwmPrepareValeur(canal);
+        pwmEtablitValeur(commande->valeur);
+    }
+    registre = commande->commande - PRECIS1;
+    canal = registre / I2C_TAILLE_PRECIS;
+    if (canal < PWM_NOMBRE_DE_CANAUX) {
+        // Les bits de poids faible appliquent la valeur:
+        if (registre & 1) {
+            precisionRecue[canal] = commande->valeur & 3;
+            pwmPrepareValeur(canal);
+            pwmEtablitValeurPrecise(((unsigned int) valeurRecue[canal] << 2) | precisionRecue[canal]);
+        } else {
+            valeurRecue[canal] = commande->valeur;
+        }
+    }
+    canal = commande->commande - VITESSE1;
+    if (canal < PWM_NOMBRE_DE_CANAUX) {
+        pwmPrepareValeur(canal);
+        pwmEtablitVitesse(commande->valeur);
+    }
+    registre = commande->commande - CALIBRATION1;
+    canal = registre / I2C_TAILLE_CALIBRATION;
+    if (canal < PWM_NOMBRE_DE_CANAUX_CALIBRES) {
+        calibrationRecue[canal][registre % I2C_TAILLE_CALIBRATION] = commande->valeur;
+        calibrationModifiee[canal] = 255;
+    }
+}
+
+/**
+ * Publie les valeurs établies pour la trame suivante, toutes ensemble.
+ */
+static void recepteurPublie() {
+#ifdef PWM_SEQUENCEUR
+    sequenceurPrepare();
+#else
+    pwmPublie();
+#endif
+}
+
+/**
+ * Applique toutes les commandes des rafales terminées, et les publie.
+ * Les canaux d'une même rafale (voir i2cPrepareRafalePourEmission) 
+ * changent donc sur la même trame, même si la boucle principale tourne
+ * pendant la réception de la rafale.
+ */
+static void recepteurAppliqueCommandesRecues() {
+    Commande commande;
+#ifdef RECEPTEUR_MESURE_LATENCE
+    unsigned int debut;
+#endif
+    if (i2cCommandeRecue()) {
+#ifdef RECEPTEUR_MESURE_LATENCE
+        // Une rafale est terminée, et attend: instantStop ne change 
+        // plus tant que la file n'est pas vidée.
+        debut = recepteurInstantStop();
+#endif
+        do {
+            i2cLitCommandeRecue(&commande);
+            recepteurAppliqueCommande(&commande);
+        } while (i2cCommandeRecue());
+        recepteurPublie();
+#ifdef RECEPTEUR_MESURE_LATENCE
+        recepteurMesureLatence(debut);
+#endif
+    }
+}
+
+/**
+ * Rend la valeur générique actuelle du canal, sur 10 bits: la dernière
+ * mesurée avec RECEPTEUR_CAPTURE, la dernière reçue autrement.
+ * @param canal Le numéro de canal.
+ * @return Une valeur entre 0 et 1023.
+ */
+static unsigned int recepteurValeurGenerique(unsigned char canal) {
+#ifdef RECEPTEUR_CAPTURE
+    return (unsigned int) pwmValeurCapturee(canal) << 2;
+#else
+    return ((unsigned int) valeurRecue[canal] << 2) | precisionRecue[canal];
+#endif
+}
+
+/**
+ * Reconstruit la table des canaux dont la calibration a changé, et 
+ * leur réapplique leur valeur générique actuelle. La reconstruction est 
+ * longue: elle se fait dans la boucle principale, jamais dans une 
+ * interruption. Les champs de calibration ne sont appliqués qu'à la fin
+ * de leur rafale (voir i2cCommandeRecue), et copiés ici sans 
+ * interruption: la table n'est jamais construite avec une partie des
+ * champs d'une rafale. Avec RECEPTEUR_APPLICATION_DIRECTE, une valeur 
+ * reçue pendant la reconstruction peut sortir sur une trame avec une 
+ * table incomplète; elle est corrigée dès la fin de la reconstruction.
+ */
+static void recepteurAppliqueCalibrations() {
+    Calibration calibration;
+    unsigned char canal;
+
+    for (canal = 0; canal < PWM_NOMBRE_DE_CANAUX_CALIBRES; canal++) {
+        if (calibrationModifiee[canal]) {
+            INTCONbits.GIEL = 0;
+            calibrationModifiee[canal] = 0;
+            calibration.minimum = calibrationRecue[canal][0];
+            calibration.maximum = calibrationRecue[canal][1];
+            calibration.centre = calibrationRecue[canal][2];
+            calibration.inverse = calibrationRecue[canal][3];
+            INTCONbits.GIEL = 1;
+            pwmCalibre(canal, &calibration);
+
+            // Un canal inactif le reste:
+            INTCONbits.GIEL = 0;
+            if (pwmValeur(canal)) {
+                pwmPrepareValeur(canal);
+                pwmEtablitValeurPrecise(recepteurValeurGenerique(canal));
+                recepteurPublie();
+            }
+            INTCONbits.GIEL = 1;
+        }
+    }
+}
+
+/**
+ * Indique si une calibration attend d'être appliquée.
+ * @return 255 si oui, 0 sinon.
+ */
+static unsigned char recepteurCalibrationEnAttente() {
+    unsigned char canal;
+
+    for (canal = 0; canal < PWM_NOMBRE_DE_CANAUX_CALIBRES; canal++) {
+        if (calibrationModifiee[canal]) {
+            return 255;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Génère les impulsions PWM. Ce traitement doit être aussi court
+ * que possible.
+ */
+static void recepteurInterruptionsPwm() {
+#ifdef PWM_SEQUENCEUR
+#ifdef RECEPTEUR_MESURE_GIGUE
+    unsigned int instant;
+#endif
+    if (PIR4bits.CCP4IF) {
+        TRACE_ENREGISTRE(TRACE_PWM, TRACE_CCP4IF);
+#ifdef RECEPTEUR_MESURE_GIGUE
+        instant = TMR1L;
+        instant |= (unsigned int) TMR1H << 8;
+        recepteurMesureRetardPwm(instant - (((unsigned int) CCPR4H << 8) | CCPR4L));
+#endif
+    }
+    sequenceurInterruptions();
+#else
     unsigned char p1, p3;
     
     if (PIR1bits.TMR2IF) {
+        TRACE_ENREGISTRE(TRACE_PWM, TRACE_TMR2IF);
+#ifdef RECEPTEUR_MESURE_GIGUE
+        // TMR2 compte depuis la fin de période, à 4 cycles par pas:
+        recepteurMesureRetardPwm((unsigned int) TMR2 << 2);
+#endif
         if (pwmEspacement()) {
-            p1 = pwmValeur(0);
-            p3 = pwmValeur(1);
+            // Une nouvelle fréquence de trame s'applique ici:
+            PR2 = pwmPeriodeTmr2();
+            p1 = pwmValeurPubliee(0);
+            p3 = pwmValeurPubliee(1);
             CCPR3L = p3;
+            CCP3CONbits.DC3B = pwmValeurPublieeFine(1);
             CCPR1L = p1;
+            CCP1CONbits.DC1B = pwmValeurPublieeFine(0);
         } else {
             CCPR3L = 0;
+            CCP3CONbits.DC3B = 0;
             CCPR1L = 0;
+            CCP1CONbits.DC1B = 0;
         }
         PIR1bits.TMR2IF = 0;
     }
+#endif
+}
+
+/**
+ * Point d'entrée des interruptions haute priorité.
+ */
+void recepteurInterruptionsHautePriorite() {
+#ifndef RECEPTEUR_PWM_BASSE_PRIORITE
+    recepteurInterruptionsPwm();
+#endif
+}
+
+/**
+ * Point d'entrée des interruptions basse priorité.
+ */
+void recepteurInterruptions() {
+    unsigned char finDeRafale;
+
+#ifdef RECEPTEUR_PWM_BASSE_PRIORITE
+    recepteurInterruptionsPwm();
+#endif
+
+#ifdef RECEPTEUR_CAPTURE
+#ifdef TRACE
+    if (PIR2bits.CCP2IF || PIR4bits.CCP5IF) {
+        TRACE_ENREGISTRE(traceBasse, TRACE_CAPTURE);
+    }
+#endif
+    if (captureInterruptions()) {
+        recepteurPublie();
+    }
+#endif
 
     if (PIR1bits.SSP1IF) {
-        if (SSP1STATbits.P) {
+        TRACE_ENREGISTRE(traceBasse, TRACE_SSP1IF);
+        finDeRafale = SSP1STATbits.P;
+        if (SSP1STATbits.R_NOT_W) {
+            // Le maître lit: après l'adresse, ou après chaque octet 
+            // qu'il a acquitté, l'horloge est retenue (CKP = 0) jusqu'à
+            // ce que le registre suivant soit dans SSP1BUF.
+            if (!SSP1STATbits.DA) {
+                SSP1BUF;                // Lit l'adresse, efface BF.
+                recepteurEmetRegistre();
+            } else if (!SSP1CON2bits.ACKSTAT) {
+                recepteurEmetRegistre();
+            }
+        } else if (SSP1STATbits.BF) {
+            // L'octet reçu est lu avant de traiter le STOP: si 
+            // l'interruption a été retardée, le dernier octet de la
+            // rafale et le STOP peuvent arriver ensemble.
+            // Chaque octet de données d'une rafale est enfilé
+            // dès sa réception:
+            if (SSP1STATbits.DA) {
+                i2cReceptionDonnee(SSP1BUF);
+            } else {
+                i2cReceptionAdresse(SSP1BUF);
+            }
+        } else if (!SSP1STATbits.P) {
+            // START, ou START répété: le maître enchaîne les commandes 
+            // sans STOP, parfois vers un autre esclave. La rafale 
+            // précédente est terminée.
+            finDeRafale = 255;
+        }
+        if (finDeRafale) {
+#ifdef RECEPTEUR_MESURE_LATENCE
+            // Seule la fin de la plus ancienne rafale en attente compte:
+            if (!i2cCommandeRecue()) {
+                instantStop = recepteurChronometre();
+            }
+#endif
             i2cFinDeReception();
-        } else {
-            if (SSP1STATbits.BF) {
-                if (SSP1STATbits.DA) {
-                    i2cReceptionDonnee(SSP1BUF);
-                } else {
-                    i2cReceptionAdresse(SSP1BUF);
-                }
+            // Après un débordement, le MSSP refuse tous les octets tant
+            // que SSPOV n'est pas effacé; la rafale est perdue, mais pas
+            // les suivantes:
+            if (SSP1CON1bits.SSPOV) {
+                debordements++;
+                SSP1CON1bits.SSPOV = 0;
             }
+#ifdef RECEPTEUR_APPLICATION_DIRECTE
+            recepteurAppliqueCommandesRecues();
+#endif
         }
         PIR1bits.SSP1IF = 0;
     }
 }
 
+/**
+ * Lit le numéro du récepteur sur les cavaliers RB5 (bit 0), RB6 (bit 1)
+ * et RB7 (bit 2). Un cavalier relie la broche à la masse et met son 
+ * bit à 1; sans cavalier, les résistances de tirage donnent le numéro 0,
+ * c'est à dire MODULE_SERVO.
+ * RB6 et RB7 sont aussi les broches de programmation: les cavaliers 
+ * doivent être retirés pendant la programmation.
+ * @return Le numéro du récepteur, entre 0 et I2C_NOMBRE_DE_MODULES - 1.
+ */
+static unsigned char recepteurLitNumero() {
+    unsigned char numero = 0;
+
+    TRISBbits.RB5 = 1;          // RB5 à RB7 comme entrées...
+    TRISBbits.RB6 = 1;
+    TRISBbits.RB7 = 1;
+    ANSELBbits.ANSB5 = 0;       // ... digitales (RB6 et RB7 le sont toujours).
+    INTCON2bits.RBPU = 0;       // Active les résistances de tirage...
+    WPUBbits.WPUB5 = 1;         // ... des trois cavaliers.
+    WPUBbits.WPUB6 = 1;
+    WPUBbits.WPUB7 = 1;
+
+    if (!PORTBbits.RB5) {
+        numero |= 1;
+    }
+    if (!PORTBbits.RB6) {
+        numero |= 2;
+    }
+    if (!PORTBbits.RB7) {
+        numero |= 4;
+    }
+    return numero;
+}
+
 /**
  * Initialise le hardware pour l'émetteur.
  */
 static void recepteurInitialiseHardware() {
     
+#ifdef PWM_SEQUENCEUR
+    sequenceurInitialiseHardware();
+#ifdef RECEPTEUR_PWM_BASSE_PRIORITE
+    IPR4bits.CCP4IP = 0;        // Séquenceur en basse priorité.
+#else
+    IPR4bits.CCP4IP = 1;        // Séquenceur en haute priorité.
+#endif
+#else
     // Prépare Temporisateur 2 pour PWM (compte jusqu'à 125 en 2ms):
-    T2CONbits.T2CKPS = 1;       // Diviseur de fréquence 1:4
+    T2CONbits.T2CKPS = HORLOGE_T2CKPS; // Un pas de PWM dure 4us.
     T2CONbits.T2OUTPS = 0;      // Pas de diviseur de fréquence à la sortie.
     T2CONbits.TMR2ON = 1;       // Active le temporisateur.
     
     PIE1bits.TMR2IE = 1;        // Active les interruptions ...
+#ifdef RECEPTEUR_PWM_BASSE_PRIORITE
     IPR1bits.TMR2IP = 0;        // ... de basse priorité ...
+#else
+    IPR1bits.TMR2IP = 1;        // ... de haute priorité ...
+#endif
     PIR1bits.TMR2IF = 0;        // ... pour le temporisateur 2.
 
     // Configure PWM 1 et 3 pour émettre le signal de radio-contrôle:
@@ -66,8 +609,10 @@ static void recepteurInitialiseHardware() {
     CCP1CONbits.CCP1M = 12;     // Active le CCP1 comme PWM.
     CCPTMRS0bits.C1TSEL = 0;    // Branche le CCP1 sur le temporisateur 2.
 
-    PR2 = 200;                  // Période est 2ms plus une marge de sécurité.
-                                // (Proteus n'aime pas que CCPRxL dépasse PRx)
+    PR2 = pwmPeriodeTmr2();     // Période selon la fréquence de trame, 
+                                // toujours plus de 2ms (Proteus n'aime pas
+                                // que CCPRxL dépasse PRx).
+#endif
 
     // Active le MSSP1 en mode Esclave I2C:
     TRISCbits.RC3 = 1;          // RC3 comme entrée...
@@ -77,17 +622,31 @@ static void recepteurInitialiseHardware() {
 
     SSP1CON1bits.SSPEN = 1;     // Active le module SSP.    
     
-    SSP1ADD = MODULE_SERVO;     // Adresse de l'esclave.
-    SSP1MSK = 0xFF;             // L'esclave n'a qu'une adresse.
+    SSP1ADD = i2cAdresseModule(recepteurLitNumero());
+    SSP1MSK = 0xFF;             // L'esclave n'a qu'une adresse...
+    SSP1CON2bits.GCEN = 1;      // ... plus l'appel général.
+    SSP1STATbits.SMP = HORLOGE_SMP;
     SSP1CON1bits.SSPM = 0b1110; // SSP1 en mode esclave I2C avec adresse de 7 bits et interruptions STOP et START.
     
     SSP1CON3bits.PCIE = 1;      // Active l'interruption en cas STOP.
-    SSP1CON3bits.SCIE = 0;      // Désactive l'interruption en cas de START.
+    SSP1CON3bits.SCIE = 1;      // ... et en cas de START ou START répété.
     SSP1CON3bits.SBCDE = 1;     // Produit une interruption en cas de collision.
 
     PIE1bits.SSP1IE = 1;        // Interruption en cas de transmission I2C...
     IPR1bits.SSP1IP = 0;        // ... de basse priorité.
 
+#ifdef RECEPTEUR_CAPTURE
+    captureInitialiseHardware();
+#endif
+
+#ifdef RECEPTEUR_MESURE_LATENCE
+    // Temporisateur 5 en libre cours, pour mesurer la latence:
+    T5CONbits.TMR5CS = 0;       // Source: FOSC / 4.
+    T5CONbits.T5CKPS = 0;       // Pas de diviseur de fréquence.
+    T5CONbits.T5RD16 = 1;       // Lecture 16 bits en une opération.
+    T5CONbits.TMR5ON = 1;       // Active le temporisateur.
+#endif
+
     // Active les interruptions générales:
     RCONbits.IPEN = 1;
     INTCONbits.GIEH = 1;
@@ -95,27 +654,70 @@ static void recepteurInitialiseHardware() {
 }
 
 /**
- * Point d'entrée pour l'émetteur de radio contrôle.
+ * Initialise le hardware et les modules du récepteur.
  */
-void recepteurMain(void) {
-    Commande commande;
+void recepteurInitialise(void) {
+    unsigned char canal;
 
     recepteurInitialiseHardware();
+    for (canal = 0; canal < PWM_NOMBRE_DE_CANAUX; canal++) {
+        valeurRecue[canal] = 0;
+        precisionRecue[canal] = 0;
+    }
+    for (canal = 0; canal < PWM_NOMBRE_DE_CANAUX_CALIBRES; canal++) {
+        calibrationRecue[canal][0] = 0;     // Calibration neutre.
+        calibrationRecue[canal][1] = 255;
+        calibrationRecue[canal][2] = 0;
+        calibrationRecue[canal][3] = 0;
+        calibrationModifiee[canal] = 0;
+    }
+    debordements = 0;
+    collisions = 0;
     pwmReinitialise();
+#ifdef PWM_SEQUENCEUR
+    sequenceurReinitialise();
+#endif
     i2cReinitialise();
+}
+
+/**
+ * Une itération de la boucle principale du récepteur.
+ */
+void recepteurBoucle(void) {
+#ifndef RECEPTEUR_APPLICATION_DIRECTE
+    recepteurAppliqueCommandesRecues();
+#endif
+    recepteurAppliqueCalibrations();
+#ifdef TRACE
+    traceConsole();
+#endif
+}
+
+/**
+ * Met le récepteur au REPOS jusqu'à la prochaine interruption, s'il n'a
+ * pas de commande ni de calibration à appliquer. L'oscillateur reste actif: TMR2, CCP1,
+ * CCP3 et CCP4 continuent à générer les impulsions, et le réveil ne 
+ * demande aucun démarrage d'oscillateur. Seul GIEL est masqué pendant
+ * la vérification: l'interruption PWM de haute priorité n'est pas 
+ * retardée (sauf avec RECEPTEUR_PWM_BASSE_PRIORITE). Avec TRACE, la 
+ * console est scrutée après chaque interruption PWM (TMR2 ou CCP4).
+ */
+static void recepteurAttend() {
+    INTCONbits.GIEL = 0;
+    if (!i2cCommandeRecue() && !recepteurCalibrationEnAttente()) {
+        veilleAttend(VEILLE_REPOS);
+    }
+    INTCONbits.GIEL = 1;
+}
+
+/**
+ * Point d'entrée pour le récepteur de radio contrôle.
+ */
+void recepteurMain(void) {
+    recepteurInitialise();
 
     while(1) {
-        if (i2cCommandeRecue()) {
-            i2cLitCommandeRecue(&commande);
-            switch (commande.commande) {
-                case SERVO1:
-                    pwmPrepareValeur(0);
-                    break;
-                case SERVO2:
-                    pwmPrepareValeur(1);
-                    break;
-            }
-            pwmEtablitValeur(commande.valeur);
-        }
+        recepteurBoucle();
+        recepteurAttend();
     }
 }
@@ -2,6 +2,19 @@
 #define RECEPTEUR__H
 
 void recepteurInterruptions();
+void recepteurInterruptionsHautePriorite();
+void recepteurInitialise(void);
+void recepteurBoucle(void);
 void recepteurMain(void);
 
+#ifdef RECEPTEUR_MESURE_GIGUE
+extern unsigned int recepteurRetardPwmMinimum;
+extern unsigned int recepteurRetardPwmMaximum;
+#endif
+
+#ifdef RECEPTEUR_MESURE_LATENCE
+extern unsigned int recepteurLatence;
+extern unsigned int recepteurLatenceMaximum;
+#endif
+
 #endif
\ No newline at end of file
@@ -0,0 +1,429 @@
+#include <xc.h>
+#include "pwm.h"
+#include "sequenceur.h"
+#include "horloge.h"
+#include "test.h"
+
+/*
+ * Séquenceur de servos: génère les impulsions de PWM_NOMBRE_DE_CANAUX
+ * canaux sur des sorties digitales, avec un seul temporisateur (TMR1) et
+ * le module CCP4 en mode comparaison.
+ *
+ * Au début de chaque trame, toutes les sorties actives passent à 1. Les
+ * fronts descendants sont triés par instant croissant, et les canaux
+ * qui descendent au même instant sont regroupés dans un seul événement.
+ * Chaque interruption traite un seul événement, et coûte toujours le
+ * même temps, quel que soit le nombre de canaux.
+ *
+ * Le tri se fait hors interruption (sequenceurPrepare), dans une table
+ * de réserve. L'interruption bascule sur la nouvelle table au début de
+ * la trame suivante.
+ */
+
+/**
+ * Durée d'une trame, en pas du temporisateur 1, selon la fréquence de 
+ * trame choisie (voir pwmChoisitFrequence) lors de la dernière 
+ * préparation. Chaque table porte sa durée dans son dernier événement:
+ * une nouvelle fréquence s'applique donc, comme les valeurs, au début 
+ * de la trame suivante.
+ */
+static unsigned int dureeTrame = 0;
+
+#if PWM_NOMBRE_DE_CANAUX > 16
+#error "Le séquenceur ne gère que 16 canaux (voir sequenceurPort)"
+#endif
+
+/**
+ * Durée d'une interruption du séquenceur, en cycles d'instruction, 
+ * entrée et sortie comprises, dans le pire cas: la fin de trame, qui
+ * bascule sur la table préparée. Elle ne dépend pas du nombre de
+ * canaux. La mesure est CYCLES recepteurHaute+CCP4IF de 
+ * outils/cycles.sh, avec PWM_SEQUENCEUR et 2, 8 ou 16 canaux.
+ *
+ * Faute de gpsim, la valeur par défaut compte les instructions de ce
+ * chemin, avec XC8 en mode free et sans TRACE ni RECEPTEUR_MESURE_GIGUE:
+ *
+ *   canaux                                   2     8     16
+ *   latence et saut au vecteur               5     5     5
+ *   sauvegarde et restauration du contexte  46    46    46
+ *   appels jusqu'à sequenceurInterruptions  20    20    20
+ *   sequenceurInterruptions                159   159   159
+ *   total                                  230   230   230
+ *
+ * Soit un écart minimum de 920us à 1MHz, 232us à 4MHz, 58us à 16MHz
+ * et 14,5us à 64MHz. À 1MHz, deux canaux proches sont donc fortement
+ * décalés: le séquenceur y convient mal.
+ */
+#ifndef SEQUENCEUR_CYCLES_INTERRUPTION
+#define SEQUENCEUR_CYCLES_INTERRUPTION 230
+#endif
+
+/**
+ * Écart minimum entre deux événements, en pas du temporisateur 1: la
+ * durée de l'interruption. Le temps que l'interruption reprogramme le 
+ * comparateur, un front plus rapproché serait manqué. Il est donc 
+ * retardé jusqu'à cet écart, et l'impulsion est allongée de moins de 
+ * cet écart, mais jamais raccourcie.
+ */
+#define SEQUENCEUR_ECART_MINIMUM \
+    ((SEQUENCEUR_CYCLES_INTERRUPTION + (1 << HORLOGE_T13CKPS) - 1) >> HORLOGE_T13CKPS)
+
+/** Nombre de ports utilisés: A, B et C. */
+#define SEQUENCEUR_NOMBRE_DE_PORTS 3
+
+/** Port de chaque canal: 0 pour A, 1 pour B, 2 pour C. */
+static const unsigned char sequenceurPort[16] = {
+    0, 0, 0, 0, 0, 0, 0, 0,     // RA0 à RA7
+    1, 1, 1, 1,                 // RB0 à RB3 (RB4 choisit le mode)
+    2, 2, 2, 2                  // RC0, RC1, RC2, RC5 (RC3 et RC4 pour I2C)
+};
+
+/** Masque de la sortie de chaque canal, dans son port. */
+static const unsigned char sequenceurMasque[16] = {
+    0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+    0x01, 0x02, 0x04, 0x08,
+    0x01, 0x02, 0x04, 0x20
+};
+
+/**
+ * Un événement: l'instant, depuis le début de la trame, et les sorties
+ * qui doivent passer à zéro à cet instant.
+ */
+typedef struct {
+    unsigned int instant;
+    unsigned char masque[SEQUENCEUR_NOMBRE_DE_PORTS];
+} Evenement;
+
+/**
+ * Deux tables d'événements: l'une est utilisée par l'interruption,
+ * l'autre est en préparation. Le dernier événement est la fin de trame.
+ */
+static Evenement evenements[2][PWM_NOMBRE_DE_CANAUX + 1];
+
+/** Nombre d'événements de chaque table, fin de trame comprise. */
+static unsigned char nombreEvenements[2];
+
+/** Sorties à activer au début de la trame, pour chaque table. */
+static unsigned char masqueDebut[2][SEQUENCEUR_NOMBRE_DE_PORTS];
+
+/** Table utilisée par l'interruption. */
+static volatile unsigned char tableActive = 0;
+
+/** Indique que l'autre table est prête à être utilisée. */
+static volatile unsigned char tablePrete = 0;
+
+/** Prochain événement à traiter par l'interruption. */
+static unsigned char evenementEnCours = 0;
+
+/** Instant du début de la trame en cours, selon TMR1. */
+static unsigned int debutTrame = 0;
+
+/**
+ * Trie les fronts descendants de tous les canaux actifs, et les publie
+ * pour la trame suivante. Doit être appelée après chaque modification
+ * des valeurs PWM. Ne doit pas être appelée par l'interruption
+ * du séquenceur.
+ */
+void sequenceurPrepare() {
+    unsigned char ordre[PWM_NOMBRE_DE_CANAUX];
+    unsigned int instant[PWM_NOMBRE_DE_CANAUX];
+    unsigned char canal, nombre, n, m, port, masque, table;
+    unsigned int duree;
+    Evenement *e;
+
+    // L'interruption ne doit pas basculer pendant la préparation:
+    tablePrete = 0;
+    table = tableActive ^ 1;
+    dureeTrame = pwmDureeTrame() * HORLOGE_PAS_PAR_4US;
+
+    // Tri par insertion des canaux actifs, par durée croissante:
+    nombre = 0;
+    for (canal = 0; canal < PWM_NOMBRE_DE_CANAUX; canal++) {
+        duree = pwmValeurDixBits(canal) * HORLOGE_PAS_PAR_4US
+                + ((pwmValeurPrecision(canal) * HORLOGE_PAS_PAR_4US) >> 2);
+        if (duree) {
+            m = nombre++;
+            while ((m > 0) && (instant[m - 1] > duree)) {
+                ordre[m] = ordre[m - 1];
+                instant[m] = instant[m - 1];
+                m--;
+            }
+            ordre[m] = canal;
+            instant[m] = duree;
+        }
+    }
+
+    // Regroupe les fronts simultanés dans le même événement, et retarde
+    // les fronts trop proches de l'événement précédent:
+    for (port = 0; port < SEQUENCEUR_NOMBRE_DE_PORTS; port++) {
+        masqueDebut[table][port] = 0;
+    }
+    e = evenements[table];
+    n = 0;
+    for (m = 0; m < nombre; m++) {
+        port = sequenceurPort[ordre[m]];
+        masque = sequenceurMasque[ordre[m]];
+        masqueDebut[table][port] |= masque;
+        if ((n > 0) && (instant[m] > e[n - 1].instant)
+                && (instant[m] - e[n - 1].instant < SEQUENCEUR_ECART_MINIMUM)) {
+            instant[m] = e[n - 1].instant + SEQUENCEUR_ECART_MINIMUM;
+        }
+        if ((n == 0) || (instant[m] > e[n - 1].instant)) {
+            e[n].instant = instant[m];
+            e[n].masque[0] = 0;
+            e[n].masque[1] = 0;
+            e[n].masque[2] = 0;
+            n++;
+        }
+        e[n - 1].masque[port] |= masque;
+    }
+
+    // Fin de trame:
+    e[n].instant = dureeTrame;
+    e[n].masque[0] = 0;
+    e[n].masque[1] = 0;
+    e[n].masque[2] = 0;
+    nombreEvenements[table] = n + 1;
+
+    tablePrete = 255;
+}
+
+/**
+ * Traite l'événement en cours, et programme le comparateur pour
+ * le suivant.
+ */
+void sequenceurInterruptions() {
+    Evenement *e;
+    unsigned int prochain;
+
+    if (PIR4bits.CCP4IF) {
+        e = &evenements[tableActive][evenementEnCours];
+        LATA &= ~e->masque[0];
+        LATB &= ~e->masque[1];
+        LATC &= ~e->masque[2];
+
+        if (++evenementEnCours >= nombreEvenements[tableActive]) {
+            // Début de la trame suivante, à la fin de celle-ci:
+            debutTrame += e->instant;
+            if (tablePrete) {
+                tableActive ^= 1;
+                tablePrete = 0;
+            }
+            LATA |= masqueDebut[tableActive][0];
+            LATB |= masqueDebut[tableActive][1];
+            LATC |= masqueDebut[tableActive][2];
+            evenementEnCours = 0;
+        }
+
+        prochain = debutTrame + evenements[tableActive][evenementEnCours].instant;
+        CCPR4H = prochain >> 8;
+        CCPR4L = prochain;
+        PIR4bits.CCP4IF = 0;
+    }
+}
+
+/**
+ * Initialise le hardware du séquenceur: les sorties, le temporisateur 1
+ * et le module CCP4.
+ */
+void sequenceurInitialiseHardware() {
+    unsigned char canal, masque;
+
+    dureeTrame = pwmDureeTrame() * HORLOGE_PAS_PAR_4US;
+
+    for (canal = 0; canal < PWM_NOMBRE_DE_CANAUX; canal++) {
+        masque = sequenceurMasque[canal];
+        switch (sequenceurPort[canal]) {
+            case 0:
+                LATA &= ~masque;
+                ANSELA &= ~masque;
+                TRISA &= ~masque;
+                break;
+            case 1:
+                LATB &= ~masque;
+                ANSELB &= ~masque;
+                TRISB &= ~masque;
+                break;
+            default:
+                LATC &= ~masque;
+                ANSELC &= ~masque;
+                TRISC &= ~masque;
+                break;
+        }
+    }
+
+    // Temporisateur 1 en libre cours, HORLOGE_PAS_PAR_4US pas pour 4us:
+    T1CONbits.TMR1CS = 0;       // Source: FOSC / 4.
+    T1CONbits.T1CKPS = HORLOGE_T13CKPS;
+    T1CONbits.T1RD16 = 1;       // Lecture / écriture 16 bits.
+    T1CONbits.TMR1ON = 1;       // Active le temporisateur.
+
+    // CCP4 en mode comparaison, sur le temporisateur 1:
+    CCPTMRS1bits.C4TSEL = 0;    // Branche le CCP4 sur le temporisateur 1.
+    CCPR4H = dureeTrame >> 8;
+    CCPR4L = dureeTrame & 0xFF;
+    CCP4CONbits.CCP4M = 0b1010; // Comparaison, interruption seulement.
+
+    PIE4bits.CCP4IE = 1;        // Active les interruptions pour le CCP4.
+    PIR4bits.CCP4IF = 0;        // (la priorité est choisie par l'appelant)
+}
+
+/**
+ * Réinitialise le séquenceur: aucune sortie n'est active.
+ */
+void sequenceurReinitialise() {
+    unsigned char table, port;
+
+    dureeTrame = pwmDureeTrame() * HORLOGE_PAS_PAR_4US;
+
+    for (table = 0; table < 2; table++) {
+        for (port = 0; port < SEQUENCEUR_NOMBRE_DE_PORTS; port++) {
+            masqueDebut[table][port] = 0;
+            evenements[table][0].masque[port] = 0;
+        }
+        evenements[table][0].instant = dureeTrame;
+        nombreEvenements[table] = 1;
+    }
+    tableActive = 0;
+    tablePrete = 0;
+    evenementEnCours = 0;
+    debutTrame = 0;
+}
+
+#ifdef TEST
+void testSequenceurSansCanal() {
+    pwmReinitialise();
+    sequenceurReinitialise();
+    sequenceurPrepare();
+
+    testeEgaliteEntiers("SEQV01", tablePrete, 255);
+    testeEgaliteEntiers("SEQV02", nombreEvenements[1], 1);
+    testeEgaliteEntiers("SEQV03", evenements[1][0].instant, dureeTrame);
+    testeEgaliteEntiers("SEQV04", masqueDebut[1][0], 0);
+}
+
+void testSequenceurTriDesFronts() {
+    pwmReinitialise();
+    sequenceurReinitialise();
+
+    pwmPrepareValeur(0);
+    pwmEtablitValeur(255);
+    pwmPrepareValeur(1);
+    pwmEtablitValeur(0);
+    sequenceurPrepare();
+
+    // Le canal 1 descend en premier:
+    testeEgaliteEntiers("SEQT01", nombreEvenements[1], 3);
+    testeEgaliteEntiers("SEQT02", evenements[1][0].instant, pwmValeurDixBits(1) * HORLOGE_PAS_PAR_4US);
+    testeEgaliteEntiers("SEQT03", evenements[1][0].masque[0], sequenceurMasque[1]);
+    testeEgaliteEntiers("SEQT04", evenements[1][1].instant, pwmValeurDixBits(0) * HORLOGE_PAS_PAR_4US);
+    testeEgaliteEntiers("SEQT05", evenements[1][1].masque[0], sequenceurMasque[0]);
+    testeEgaliteEntiers("SEQT06", evenements[1][2].instant, dureeTrame);
+    testeEgaliteEntiers("SEQT07", evenements[1][2].masque[0], 0);
+    testeEgaliteEntiers("SEQT08", masqueDebut[1][0], sequenceurMasque[0] | sequenceurMasque[1]);
+}
+
+void testSequenceurValeurPrecise() {
+    pwmReinitialise();
+    sequenceurReinitialise();
+
+    // Les quarts de pas comptent quand l'horloge a plusieurs pas pour 4us:
+    pwmPrepareValeur(0);
+    pwmEtablitValeurPrecise((100 << 2) | 2);
+    sequenceurPrepare();
+    testeEgaliteEntiers("SEQP01", evenements[1][0].instant, 
+            pwmValeurDixBits(0) * HORLOGE_PAS_PAR_4US + (2 * HORLOGE_PAS_PAR_4US >> 2));
+}
+
+void testSequenceurRegroupeLesFrontsProches() {
+    unsigned int premier, second;
+
+    pwmReinitialise();
+    sequenceurReinitialise();
+
+    // Deux fronts simultanés partagent le même événement:
+    pwmPrepareValeur(0);
+    pwmEtablitValeur(100);
+    pwmPrepareValeur(1);
+    pwmEtablitValeur(100);
+    sequenceurPrepare();
+
+    testeEgaliteEntiers("SEQR01", nombreEvenements[1], 2);
+    testeEgaliteEntiers("SEQR02", evenements[1][0].instant, pwmValeurDixBits(0) * HORLOGE_PAS_PAR_4US);
+    testeEgaliteEntiers("SEQR03", evenements[1][0].masque[0], sequenceurMasque[0] | sequenceurMasque[1]);
+
+    // Un front trop proche est retardé, jamais avancé:
+    pwmEtablitValeur(101);
+    sequenceurPrepare();
+    premier = pwmValeurDixBits(0) * HORLOGE_PAS_PAR_4US;
+    second = pwmValeurDixBits(1) * HORLOGE_PAS_PAR_4US;
+    if (second < premier + SEQUENCEUR_ECART_MINIMUM) {
+        second = premier + SEQUENCEUR_ECART_MINIMUM;
+    }
+    testeEgaliteEntiers("SEQR04", nombreEvenements[1], 3);
+    testeEgaliteEntiers("SEQR05", evenements[1][0].instant, premier);
+    testeEgaliteEntiers("SEQR06", evenements[1][0].masque[0], sequenceurMasque[0]);
+    testeEgaliteEntiers("SEQR07", evenements[1][1].instant, second);
+    testeEgaliteEntiers("SEQR08", evenements[1][1].masque[0], sequenceurMasque[1]);
+}
+
+void testSequenceurBasculeEnDebutDeTrame() {
+    pwmReinitialise();
+    sequenceurReinitialise();
+
+    pwmPrepareValeur(0);
+    pwmEtablitValeur(100);
+    sequenceurPrepare();
+    testeEgaliteEntiers("SEQB01", tableActive, 0);
+
+    // Fin de la trame en cours (vide):
+    PIR4bits.CCP4IF = 1;
+    sequenceurInterruptions();
+    testeEgaliteEntiers("SEQB02", tableActive, 1);
+    testeEgaliteEntiers("SEQB03", tablePrete, 0);
+    testeEgaliteEntiers("SEQB04", LATA & sequenceurMasque[0], sequenceurMasque[0]);
+
+    // Front descendant du canal 0:
+    PIR4bits.CCP4IF = 1;
+    sequenceurInterruptions();
+    testeEgaliteEntiers("SEQB05", LATA & sequenceurMasque[0], 0);
+    testeEgaliteEntiers("SEQB06", evenementEnCours, 1);
+}
+
+void testSequenceurChangeDeFrequence() {
+    pwmChoisitFrequence(PWM_50HZ);
+    pwmReinitialise();
+    sequenceurReinitialise();
+
+    // La nouvelle fréquence part avec la prochaine publication:
+    pwmChoisitFrequence(PWM_333HZ);
+    pwmPrepareValeur(0);
+    pwmEtablitValeur(100);
+    sequenceurPrepare();
+
+    // La trame en cours (vide) garde son ancienne durée:
+    PIR4bits.CCP4IF = 1;
+    sequenceurInterruptions();
+    testeEgaliteEntiers("SEQF01", debutTrame, 5000 * HORLOGE_PAS_PAR_4US);
+    testeEgaliteEntiers("SEQF02", tableActive, 1);
+
+    // Front descendant du canal 0, puis fin de la nouvelle trame:
+    PIR4bits.CCP4IF = 1;
+    sequenceurInterruptions();
+    PIR4bits.CCP4IF = 1;
+    sequenceurInterruptions();
+    testeEgaliteEntiers("SEQF03", debutTrame, (5000 + 750) * HORLOGE_PAS_PAR_4US);
+
+    pwmChoisitFrequence(PWM_FREQUENCE);
+    pwmReinitialise();
+}
+
+void testSequenceur() {
+    testSequenceurSansCanal();
+    testSequenceurTriDesFronts();
+    testSequenceurValeurPrecise();
+    testSequenceurRegroupeLesFrontsProches();
+    testSequenceurBasculeEnDebutDeTrame();
+    testSequenceurChangeDeFrequence();
+}
+#endif
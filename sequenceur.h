@@ -0,0 +1,13 @@
+#ifndef SEQUENCEUR__H
+#define SEQUENCEUR__H
+
+void sequenceurPrepare();
+void sequenceurInterruptions();
+void sequenceurInitialiseHardware();
+void sequenceurReinitialise();
+
+#ifdef TEST
+void testSequenceur();
+#endif
+
+#endif
@@ -1,7 +1,45 @@
 #include <xc.h>
 #include <stdio.h>
+#include "test.h"
+#include "horloge.h"
 
-#ifdef TEST
+#if defined(TEST) || defined(TRACE) || defined(BANC_CYCLES)
+
+/*
+ * Options de compilation (à définir dans les options du projet):
+ *
+ * CONSOLE_NON_BLOQUANTE: Quand le tampon de la console est plein, 
+ * putch abandonne le caractère (et le compte dans consolePerdus) au 
+ * lieu d'attendre qu'il se vide. Permet de laisser des diagnostics
+ * dans un programme de production.
+ */
+
+/** Capacité du tampon de la console. Puissance de 2, qui divise 256. */
+#define CONSOLE_TAILLE 64
+#define CONSOLE_MASQUE (CONSOLE_TAILLE - 1)
+
+/**
+ * Tampon circulaire de la console, comme File (voir file.h): putch est
+ * le seul producteur, et ne modifie que consoleEntree; l'interruption
+ * de la EUSART est le seul consommateur, et ne modifie que 
+ * consoleSortie.
+ */
+static char console[CONSOLE_TAILLE];
+static volatile unsigned char consoleEntree = 0;
+static volatile unsigned char consoleSortie = 0;
+
+/** La console passe par le tampon et l'interruption de la EUSART. */
+static unsigned char consoleParInterruptions = 0;
+
+unsigned int consolePerdus = 0;
+
+/**
+ * Envoie le plus ancien caractère du tampon à la EUSART.
+ */
+static void consoleEmetSuivant() {
+    TXREG1 = console[consoleSortie & CONSOLE_MASQUE];
+    consoleSortie++;
+}
 
 /**
  * Fonction qui transmet un caractère à la EUSART.
@@ -9,35 +47,102 @@
  * appelée par <code>printf</code>.
  * Cette implémentation envoie le caractère à la UART. Si un terminal
  * est connecté aux sorties RX / TX, il affichera du texte.
+ * Après consoleActiveInterruptions, le caractère est simplement déposé
+ * dans le tampon, et putch n'attend que si le tampon est plein.
  * @param data Le code ASCII du caractère à afficher.
 */
 void putch(char data) {
-    while( ! TX1IF);
-    TXREG1 = data;
+    if (!consoleParInterruptions) {
+        while( ! PIR1bits.TX1IF);
+        TXREG1 = data;
+        return;
+    }
+    while ((unsigned char) (consoleEntree - consoleSortie) >= CONSOLE_TAILLE) {
+#ifdef CONSOLE_NON_BLOQUANTE
+        consolePerdus++;
+        return;
+#else
+        // Interruptions masquées: personne d'autre ne vide le tampon.
+        if (!(INTCONbits.GIEH && INTCONbits.GIEL) && PIR1bits.TX1IF) {
+            consoleEmetSuivant();
+        }
+#endif
+    }
+    console[consoleEntree & CONSOLE_MASQUE] = data;
+    consoleEntree++;
+    PIE1bits.TX1IE = 1;
+}
+
+/**
+ * Fait passer la console par le tampon, vidé par l'interruption de 
+ * basse priorité de la EUSART. Les interruptions doivent être activées
+ * par ailleurs (RCONbits.IPEN, GIEH et GIEL).
+ */
+void consoleActiveInterruptions() {
+    IPR1bits.TX1IP = 0;
+    consoleParInterruptions = 255;
+}
+
+/**
+ * Traite l'interruption de la EUSART: envoie le caractère suivant, et 
+ * désactive l'interruption quand le tampon est vide. putch la réactive.
+ * À appeler depuis l'interruption de basse priorité.
+ */
+void consoleInterruptions() {
+    if (PIE1bits.TX1IE && PIR1bits.TX1IF) {
+        if (consoleEntree != consoleSortie) {
+            consoleEmetSuivant();
+        }
+        if (consoleEntree == consoleSortie) {
+            PIE1bits.TX1IE = 0;
+        }
+    }
+}
+
+/**
+ * Indique si tous les caractères de la console sont partis vers la 
+ * EUSART.
+ * @return 255 si le tampon est vide.
+ */
+unsigned char consoleVide() {
+    if (consoleEntree == consoleSortie) {
+        return 255;
+    }
+    return 0;
 }
 
 void initialiseUART1() {
-    // Pour une fréquence de 1MHz, ceci donne 1200 bauds:
-    SPBRG = 12;
-    SPBRGH = 0;
+    // HORLOGE_BAUDS, quelle que soit la fréquence (voir horloge.h):
+    BAUDCONbits.BRG16 = 1;
+    TXSTAbits.BRGH = 1;
+    SPBRG = HORLOGE_SPBRG & 0xFF;
+    SPBRGH = HORLOGE_SPBRG >> 8;
     // Configure RC6 et RC7 comme entrées digitales, pour que
     // la EUSART puisse en prendre le contrôle:
     TRISCbits.RC6 = 1;
     TRISCbits.RC7 = 1;
     
     // Configure la EUSART:
-    // (BRGH et BRG16 sont à leur valeurs par défaut)
     // (TX9 est à sa valeur par défaut)
     RCSTAbits.SPEN = 1;  // Active la EUSART.
     TXSTAbits.SYNC = 0;  // Mode asynchrone.
     TXSTAbits.TXEN = 1;  // Active l'émetteur.
+    RCSTAbits.CREN = 1;  // Active le récepteur.
 }
+#endif
+
+#ifdef TEST
 
 /** Nombre de tests en erreur depuis l'initialisation des tests. */
 static int testsEnErreur = 0;
 
 void initialiseTests() {
     initialiseUART1();
+    // Les tests ne sont pas ralentis par la console:
+    consoleActiveInterruptions();
+    RCONbits.IPEN = 1;
+    INTCONbits.GIEH = 1;
+    INTCONbits.GIEL = 1;
     testsEnErreur = 0;
     printf("\r\nLancement des tests...\r\n");
 }
@@ -60,8 +165,10 @@ unsigned char testeEgaliteChars(const char *testId, char valeurObtenue, char val
     return 0;
 }
 
-void finaliseTests() {
+int finaliseTests() {
     printf("%d tests en erreur\r\n", testsEnErreur);    
+    while (!consoleVide());
+    return testsEnErreur;
 }
 
 #endif
@@ -1,6 +1,21 @@
 #ifndef TEST_H
 #define	TEST_H
 
+#if defined(TEST) || defined(TRACE) || defined(BANC_CYCLES)
+/**
+ * Configure la EUSART pour la console, et active l'émetteur et
+ * le récepteur. La console attend que chaque caractère soit parti.
+ */
+void initialiseUART1();
+
+void consoleActiveInterruptions();
+void consoleInterruptions();
+unsigned char consoleVide();
+
+/** Caractères abandonnés par CONSOLE_NON_BLOQUANTE. */
+extern unsigned int consolePerdus;
+#endif
+
 #ifdef TEST
 
 /**
@@ -13,10 +28,9 @@ void initialiseTests();
  * @param testId Identifiant du test.
  * @param value Valeur obtenue.
  * @param expectedValue Valeur attendue.
- * @return 1 si le test échoue, ce qui permet de compter le nombre
- * de tests en erreur.
+ * @return 255 si le test échoue.
  */
-int testeEgaliteEntiers(const char *testId, int value, int expectedValue);
+unsigned char testeEgaliteEntiers(const char *testId, int value, int expectedValue);
 
 /**
  * Vérifie si la valeur obtenue est égale à la valeur attendue.
@@ -29,8 +43,9 @@ unsigned char testeEgaliteChars(const char *testId, char valeurObtenue, char val
 
 /**
  * Affiche le nombre de tests en échec.
+ * @return Le nombre de tests en échec.
  */
-void finaliseTests();
+int finaliseTests();
 
 #endif
 
@@ -0,0 +1,240 @@
+#include <xc.h>
+#include <stdio.h>
+#include "trace.h"
+#include "i2c.h"
+#include "test.h"
+
+#ifdef TRACE
+
+Trace traceHaute;
+Trace traceBasse;
+
+/**
+ * Initialise la trace, le temporisateur 5 qui sert d'horloge,
+ * et la console.
+ */
+void traceInitialise() {
+    traceHaute.entree = 0;
+    traceHaute.gel = 0;
+    traceBasse.entree = 0;
+    traceBasse.gel = 0;
+
+    T5CONbits.TMR5CS = 0;       // Source: FOSC / 4.
+    T5CONbits.T5CKPS = 0;       // Pas de diviseur de fréquence.
+    T5CONbits.T5RD16 = 1;       // Lecture 16 bits en une opération.
+    T5CONbits.TMR5ON = 1;       // Active le temporisateur.
+
+    initialiseUART1();
+    consoleActiveInterruptions();
+}
+
+/**
+ * Cherche l'enregistrement suivant d'une trace gelée, du plus ancien
+ * (à la position d'entrée) au plus récent. Les positions vides sont
+ * sautées.
+ * @param trace La trace.
+ * @param n Nombre de positions déjà parcourues depuis la plus ancienne;
+ * avance jusqu'après l'enregistrement trouvé.
+ * @return La position de l'enregistrement, ou TRACE_TAILLE s'il n'y en
+ * a plus.
+ */
+static unsigned char traceSuivant(Trace *trace, unsigned char *n) {
+    unsigned char position;
+
+    while (*n < TRACE_TAILLE) {
+        position = (trace->entree + (*n)++) & TRACE_MASQUE;
+        if (trace->evenement[position]) {
+            return position;
+        }
+    }
+    return TRACE_TAILLE;
+}
+
+/**
+ * Gèle la trace et l'envoie à la console, de l'enregistrement le plus
+ * ancien au plus récent, puis la vide et la réactive.
+ * Chaque ligne a la forme: <niveau> <événement> <instant>, en hexadécimal.
+ * @param trace La trace.
+ * @param niveau 'H' pour la haute priorité, 'B' pour la basse.
+ */
+static void traceVide(Trace *trace, char niveau) {
+    unsigned char n, position;
+
+    trace->gel = 255;
+    n = 0;
+    while ((position = traceSuivant(trace, &n)) < TRACE_TAILLE) {
+        printf("%c %02X %02X%02X\r\n", niveau, 
+                trace->evenement[position], 
+                trace->instantH[position], 
+                trace->instantL[position]);
+        trace->evenement[position] = 0;
+    }
+    trace->gel = 0;
+}
+
+/**
+ * Envoie une ligne de compteurs d'une file:
+ * <nom> <enfilés> <rejetés> <occupation maximum>, en décimal.
+ * Les compteurs sont copiés avec les interruptions basse priorité
+ * masquées, car leur lecture sur 16 bits n'est pas atomique.
+ */
+static void traceCompteursFile(const char *nom, File *file) {
+    unsigned int enfiles, rejetes;
+    unsigned char maximum;
+
+    INTCONbits.GIEL = 0;
+    enfiles = file->enfiles;
+    rejetes = file->rejetes;
+    maximum = file->maximum;
+    INTCONbits.GIEL = 1;
+    printf("%s %u %u %u\r\n", nom, enfiles, rejetes, maximum);
+}
+
+/**
+ * Envoie les compteurs de télémétrie des files et du bus i2c.
+ */
+static void traceCompteurs() {
+    unsigned int emises, recues;
+
+    INTCONbits.GIEL = 0;
+    emises = i2cRafalesEmises;
+    recues = i2cRafalesRecues;
+    INTCONbits.GIEL = 1;
+
+    printf("COMPTEURS\r\n");
+    traceCompteursFile("E", &fileEmission);
+    traceCompteursFile("R", &fileReception);
+    printf("I %u %u\r\n", emises, recues);
+    printf("FIN\r\n");
+}
+
+/**
+ * Envoie une suite d'octets sur une ligne, en hexadécimal:
+ * <titre> <octet> <octet>...
+ * @param titre Le titre de la ligne.
+ * @param octets Les octets.
+ * @param nombre Le nombre d'octets.
+ */
+void traceOctets(const char *titre, unsigned char *octets, unsigned char nombre) {
+    unsigned char n;
+
+    printf("%s", titre);
+    for (n = 0; n < nombre; n++) {
+        printf(" %02X", octets[n]);
+    }
+    printf("\r\n");
+}
+
+/**
+ * À appeler depuis la boucle principale. Si la console a reçu le
+ * caractère 'T', envoie les deux traces; si elle a reçu 'C', envoie
+ * les compteurs de télémétrie.
+ * @return Le caractère reçu, s'il n'a pas été traité; 0 autrement.
+ */
+char traceConsole() {
+    char c = 0;
+
+    if (RCSTAbits.OERR) {
+        RCSTAbits.CREN = 0;    // Efface le débordement de réception.
+        RCSTAbits.CREN = 1;
+    }
+    if (PIR1bits.RC1IF) {
+        c = RCREG1;
+        if (c == 'T') {
+            printf("TRACE\r\n");
+            traceVide(&traceHaute, 'H');
+            traceVide(&traceBasse, 'B');
+            printf("FIN\r\n");
+        } else if (c == 'C') {
+            traceCompteurs();
+        } else {
+            return c;
+        }
+    }
+    return 0;
+}
+
+#ifdef TEST
+/** Une trace pour les tests, qui n'est pas celle des interruptions. */
+static Trace traceTest;
+
+/**
+ * Vide la trace de test sans l'envoyer.
+ */
+static void traceTestReinitialise() {
+    unsigned char n;
+
+    for (n = 0; n < TRACE_TAILLE; n++) {
+        traceTest.evenement[n] = 0;
+    }
+    traceTest.entree = 0;
+    traceTest.gel = 0;
+}
+
+void testTraceOrdre() {
+    unsigned char n, position;
+
+    traceTestReinitialise();
+    TRACE_ENREGISTRE(traceTest, TRACE_ENTREE);
+    TRACE_ENREGISTRE(traceTest, TRACE_SORTIE);
+
+    // Les positions vides, après l'entrée, sont sautées:
+    n = 0;
+    position = traceSuivant(&traceTest, &n);
+    testeEgaliteEntiers("TRO01", position, 0);
+    testeEgaliteEntiers("TRO02", traceTest.evenement[position], TRACE_ENTREE);
+    position = traceSuivant(&traceTest, &n);
+    testeEgaliteEntiers("TRO03", position, 1);
+    testeEgaliteEntiers("TRO04", traceTest.evenement[position], TRACE_SORTIE);
+    testeEgaliteEntiers("TRO05", traceSuivant(&traceTest, &n), TRACE_TAILLE);
+}
+
+void testTraceTourne() {
+    unsigned char n, position, attendu, erreurs;
+    unsigned int k;
+
+    // Les 3 premiers enregistrements sont écrasés par les 3 derniers:
+    traceTestReinitialise();
+    for (k = 1; k <= TRACE_TAILLE + 3; k++) {
+        TRACE_ENREGISTRE(traceTest, k);
+    }
+    testeEgaliteEntiers("TRT01", traceTest.entree, 3);
+
+    // Du plus ancien (4) au plus récent (TRACE_TAILLE + 3):
+    n = 0;
+    attendu = 4;
+    erreurs = 0;
+    while ((position = traceSuivant(&traceTest, &n)) < TRACE_TAILLE) {
+        if (traceTest.evenement[position] != attendu) {
+            erreurs++;
+        }
+        attendu++;
+    }
+    testeEgaliteEntiers("TRT02", erreurs, 0);
+    testeEgaliteEntiers("TRT03", attendu, TRACE_TAILLE + 4);
+}
+
+void testTraceGel() {
+    traceTestReinitialise();
+    TRACE_ENREGISTRE(traceTest, TRACE_ENTREE);
+
+    // Pendant l'envoi, la trace ne change pas:
+    traceTest.gel = 255;
+    TRACE_ENREGISTRE(traceTest, TRACE_SORTIE);
+    testeEgaliteEntiers("TRG01", traceTest.entree, 1);
+    testeEgaliteEntiers("TRG02", traceTest.evenement[1], 0);
+
+    traceTest.gel = 0;
+    TRACE_ENREGISTRE(traceTest, TRACE_SORTIE);
+    testeEgaliteEntiers("TRG03", traceTest.entree, 2);
+    testeEgaliteEntiers("TRG04", traceTest.evenement[1], TRACE_SORTIE);
+}
+
+void testTrace() {
+    testTraceOrdre();
+    testTraceTourne();
+    testTraceGel();
+}
+#endif
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef TRACE__H
+#define TRACE__H
+
+/**
+ * Trace des interruptions, activée par l'option TRACE.
+ * Chaque interruption enregistre son entrée, sa sortie et le drapeau
+ * qu'elle traite, avec l'instant (TMR5) où c'est arrivé. La boucle
+ * principale envoie les traces par la EUSART (HORLOGE_BAUDS, sur RC6)
+ * quand elle reçoit le caractère 'T'. Le programme
+ * outils/decodeTrace.c les transforme en histogrammes de durées.
+ * Sur le caractère 'C', elle envoie les compteurs de télémétrie:
+ *     COMPTEURS
+ *     E <enfilés> <rejetés> <maximum>    (file d'émission)
+ *     R <enfilés> <rejetés> <maximum>    (file de réception)
+ *     I <rafales émises> <rafales reçues>
+ *     FIN
+ * Dans l'émetteur, le caractère 'E' lit les registres d'état du 
+ * récepteur par I2C (voir RegistreEtat, dans i2c.h) et les envoie
+ * en hexadécimal: ETAT <registre 0> <registre 1>...
+ * Attention: dans le récepteur, RC6 est aussi la sortie PWM de CCP3;
+ * pour tracer le récepteur, il faut utiliser le séquenceur 
+ * (PWM_SEQUENCEUR) ou accepter que le canal 2 soit inutilisable.
+ */
+
+/**
+ * Événements enregistrés par la trace. Les numéros sont utilisés par
+ * outils/decodeTrace.c pour décoder la trace.
+ */
+typedef enum {
+    TRACE_ENTREE = 1,       // Entrée dans l'interruption.
+    TRACE_SORTIE = 2,       // Sortie de l'interruption.
+    TRACE_TMR2IF = 3,
+    TRACE_SSP1IF = 4,
+    TRACE_ADIF = 5,
+    TRACE_INT1F = 6,
+    TRACE_INT2F = 7,
+    TRACE_TMR0IF = 8,
+    TRACE_CCP4IF = 9,
+    TRACE_CAPTURE = 10
+} TraceEvenement;
+
+#ifdef TRACE
+
+/** Nombre d'enregistrements par trace. Doit être une puissance de 2. */
+#define TRACE_TAILLE 64
+#define TRACE_MASQUE (TRACE_TAILLE - 1)
+
+/**
+ * Une trace: chaque enregistrement est un événement et l'instant où il
+ * s'est produit, selon TMR5 (en cycles d'instruction). Les tableaux 
+ * sont séparés pour que l'enregistrement n'ait pas à multiplier l'index.
+ */
+typedef struct {
+    unsigned char evenement[TRACE_TAILLE];
+    unsigned char instantL[TRACE_TAILLE];
+    unsigned char instantH[TRACE_TAILLE];
+    unsigned char entree;
+    unsigned char gel;
+} Trace;
+
+/** Une trace par niveau d'interruption, pour qu'ils ne s'écrasent pas. */
+extern Trace traceHaute;
+extern Trace traceBasse;
+
+/**
+ * Enregistre un événement dans la trace indiquée. Quelques cycles:
+ * TMR5L est lu avant TMR5H, qui est verrouillé par la lecture de TMR5L.
+ */
+#define TRACE_ENREGISTRE(trace, e) \
+    do { \
+        if (!(trace).gel) { \
+            (trace).evenement[(trace).entree] = (e); \
+            (trace).instantL[(trace).entree] = TMR5L; \
+            (trace).instantH[(trace).entree] = TMR5H; \
+            (trace).entree = ((trace).entree + 1) & TRACE_MASQUE; \
+        } \
+    } while (0)
+
+void traceInitialise();
+char traceConsole();
+void traceOctets(const char *titre, unsigned char *octets, unsigned char nombre);
+
+#ifdef TEST
+void testTrace();
+#endif
+
+#else
+
+#define TRACE_ENREGISTRE(trace, e)
+
+#endif
+
+#endif
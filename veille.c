@@ -0,0 +1,32 @@
+#include <xc.h>
+#include "veille.h"
+
+/*
+ * Options de compilation (à définir dans les options du projet):
+ *
+ * VEILLE_AUCUNE: Les boucles principales tournent sans jamais arrêter
+ * le processeur, comme avant la mise en veille. Sert de référence pour
+ * mesurer la consommation et le délai de réveil.
+ */
+
+/**
+ * Arrête le processeur jusqu'à la prochaine interruption.
+ * L'appelant masque les interruptions qui pourraient lui donner du 
+ * travail, vérifie qu'il n'en a pas, appelle cette fonction, puis les
+ * démasque: une interruption levée entre la vérification et SLEEP 
+ * réveille quand même le microcontrôleur, car le réveil ne dépend
+ * que des bits xxIE, pas de GIEH ni de GIEL. L'interruption est
+ * ensuite servie dès qu'elle est démasquée.
+ * @param mode VEILLE_REPOS ou VEILLE_SOMMEIL.
+ */
+void veilleAttend(ModeVeille mode) {
+#ifndef VEILLE_AUCUNE
+    if (mode == VEILLE_REPOS) {
+        OSCCONbits.IDLEN = 1;
+    } else {
+        OSCCONbits.IDLEN = 0;
+    }
+    SLEEP();
+    NOP();                      // Exécutée au réveil, avant l'interruption.
+#endif
+}
@@ -0,0 +1,39 @@
+#ifndef VEILLE__H
+#define VEILLE__H
+
+/**
+ * Mise en veille du microcontrôleur entre les interruptions.
+ * Tout le travail se fait dans les interruptions: les boucles 
+ * principales arrêtent le processeur dès qu'elles n'ont plus rien à 
+ * faire, et l'interruption suivante le réveille.
+ *
+ * Mode     Horloge        Réveil par               Délai de réveil
+ * REPOS    active         toute interruption       aucun démarrage d'oscillateur
+ * SOMMEIL  arrêtée        INT1, INT2, SSP1 esclave démarrage de HFINTOSC
+ *
+ * En REPOS (IDLE), seul le processeur est arrêté: les temporisateurs,
+ * les CCP, le MSSP et le convertisseur continuent. En SOMMEIL (SLEEP),
+ * tout ce qui dépend de FOSC s'arrête, y compris une conversion en
+ * cours et le maître I2C; seuls les flancs sur INT1 et INT2 réveillent
+ * l'émetteur.
+ *
+ * Caractérisation:
+ * - La part du temps passée dans chaque mode est donnée par la 
+ *   simulation (hote/simulation -t, ligne "veille"). La consommation
+ *   moyenne s'en déduit avec les courants IDD (actif et REPOS) et IPD 
+ *   (SOMMEIL) du PIC18F25K22 à 1MHz, mesurés sur la carte avec un 
+ *   ampèremètre en série, l'option VEILLE_AUCUNE donnant la référence.
+ * - Le délai de réveil sur le chemin des impulsions se mesure avec
+ *   RECEPTEUR_MESURE_GIGUE, avec et sans VEILLE_AUCUNE: le retard entre
+ *   l'événement PWM et son traitement inclut le réveil.
+ */
+typedef enum {
+    /** IDLE: le processeur s'arrête, les périphériques continuent. */
+    VEILLE_REPOS,
+    /** SLEEP: l'oscillateur principal s'arrête. */
+    VEILLE_SOMMEIL
+} ModeVeille;
+
+void veilleAttend(ModeVeille mode);
+
+#endif